@@ -24,11 +24,19 @@ $(call compile_only_if,$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_SH1107),lvgl_tft/sh110
 $(call compile_only_if,$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_SSD1306),lvgl_tft/ssd1306.o)
 $(call compile_only_if,$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_FT81X),lvgl_tft/EVE_commands.o)
 $(call compile_only_if,$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_FT81X),lvgl_tft/FT81x.o)
+$(call compile_only_if,$(and $(CONFIG_LV_TFT_DISPLAY_CONTROLLER_FT81X),$(CONFIG_LV_FT81X_DL_RENDERER)),lvgl_tft/FT81x_draw.o)
+$(call compile_only_if,$(and $(CONFIG_LV_TFT_DISPLAY_CONTROLLER_FT81X),$(CONFIG_LV_FT81X_DL_RENDERER)),lvgl_tft/FT81x_ramg.o)
+$(call compile_only_if,$(and $(CONFIG_LV_TFT_DISPLAY_CONTROLLER_FT81X),$(CONFIG_LV_FT81X_MEDIA)),lvgl_tft/FT81x_media.o)
+$(call compile_only_if,$(and $(CONFIG_LV_TFT_DISPLAY_CONTROLLER_FT81X),$(CONFIG_LV_FT81X_FLASH_ASSETS)),lvgl_tft/FT81x_flash.o)
 $(call compile_only_if,$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_IL3820),lvgl_tft/il3820.o)
 $(call compile_only_if,$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_JD79653A),lvgl_tft/jd79653a.o)
 $(call compile_only_if,$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_UC8151D),lvgl_tft/uc8151d.o)
 $(call compile_only_if,$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_RA8875),lvgl_tft/ra8875.o)
 $(call compile_only_if,$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_GC9A01),lvgl_tft/GC9A01.o)
+$(call compile_only_if,$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_PCD8544),lvgl_tft/pcd8544.o)
+$(call compile_only_if,$(or $(CONFIG_LV_TFT_DISPLAY_CONTROLLER_SH1107),$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_SSD1306),$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_PCD8544),$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_IL3820),$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_JD79653A),$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_UC8151D)),lvgl_tft/disp_mono.o)
+$(call compile_only_if,$(or $(CONFIG_LV_TFT_DISPLAY_CONTROLLER_IL3820),$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_JD79653A),$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_UC8151D)),lvgl_tft/epd_refresh.o)
+$(call compile_only_if,$(or $(CONFIG_LV_TFT_DISPLAY_CONTROLLER_IL3820),$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_JD79653A),$(CONFIG_LV_TFT_DISPLAY_CONTROLLER_UC8151D)),lvgl_tft/epd_policy.o)
 
 $(call compile_only_if,$(CONFIG_LV_TFT_DISPLAY_PROTOCOL_SPI),lvgl_tft/disp_spi.o)
 
@@ -33,7 +33,9 @@ extern "C" {
  * When using RGB displays the display buffer size will also depends on the
  * color format being used, for RGB565 each pixel needs 2 bytes.
  * When using the mono theme, the display pixels can be represented in one bit,
- * so the buffer size can be divided by 8, e.g. see SSD1306 display size. */
+ * so the buffer size can be divided by 8, e.g. see SSD1306 display size.
+ * Without a set_px_cb the SSD1306, SH1107 and PCD8544 drivers take one lv_color_t
+ * per pixel and pack it themselves, the buffer then has to hold at least 8 rows. */
 #if defined (CONFIG_CUSTOM_DISPLAY_BUFFER_SIZE)
 #define DISP_BUF_SIZE   CONFIG_CUSTOM_DISPLAY_BUFFER_BYTES
 #else
@@ -77,8 +79,12 @@ extern "C" {
 #elif defined CONFIG_LV_TFT_DISPLAY_CONTROLLER_ILI9163C
 #define DISP_BUF_SIZE (LV_HOR_RES_MAX * 40)
 #elif defined (CONFIG_LV_TFT_DISPLAY_CONTROLLER_PCD8544)
+#if defined (CONFIG_LV_THEME_MONO)
 #define DISP_BUF_SIZE  (LV_HOR_RES_MAX * (LV_VER_RES_MAX / 8))
 #else
+#define DISP_BUF_SIZE  (LV_HOR_RES_MAX * LV_VER_RES_MAX)
+#endif
+#else
 #error "No display controller selected"
 #endif
 #endif
@@ -279,6 +279,59 @@ esp_err_t I2C_FN(_write)(i2c_port_t port, uint16_t addr, uint32_t reg, const uin
     return result;
 }
 
+esp_err_t I2C_FN(_writev)(i2c_port_t port, uint16_t addr, const I2C_FN(_segment_t) *segments, uint8_t count) {
+
+	I2C_PORT_CHECK(port, ESP_FAIL);
+
+    esp_err_t result;
+
+    // May seem weird, but init starts with a check if it's needed, no need for that check twice.
+	I2C_FN(_init)(port);
+
+    ESP_LOGV(TAG, "Writing port %d, addr 0x%03x, %d segments", port, addr, count);
+
+	TickType_t timeout = 0;
+	#if defined (I2C_ZERO)
+		if (port == I2C_NUM_0) {
+			timeout = (CONFIG_I2C_MANAGER_0_TIMEOUT) / portTICK_RATE_MS;
+		}
+	#endif
+	#if defined (I2C_ONE)
+		if (port == I2C_NUM_1) {
+			timeout = (CONFIG_I2C_MANAGER_1_TIMEOUT) / portTICK_RATE_MS;
+		}
+	#endif
+
+	if (I2C_FN(_lock)((int)port) == ESP_OK) {
+		// All segments go into one transaction, the command link only points at the buffers
+		i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+		i2c_master_start(cmd);
+		i2c_send_address(cmd, addr, I2C_MASTER_WRITE);
+		for (uint8_t i = 0; i < count; i++) {
+			if (segments[i].size) {
+				i2c_master_write(cmd, (uint8_t *)segments[i].buffer, segments[i].size, ACK_CHECK_EN);
+			}
+		}
+		i2c_master_stop(cmd);
+		result = i2c_master_cmd_begin( port, cmd, timeout);
+		i2c_cmd_link_delete(cmd);
+		I2C_FN(_unlock)((int)port);
+	} else {
+		ESP_LOGE(TAG, "Lock could not be obtained for port %d.", (int)port);
+		return ESP_ERR_TIMEOUT;
+	}
+
+    if (result != ESP_OK) {
+    	ESP_LOGW(TAG, "Error: %d", result);
+    }
+
+	for (uint8_t i = 0; i < count; i++) {
+		ESP_LOG_BUFFER_HEX_LEVEL(TAG, segments[i].buffer, segments[i].size, ESP_LOG_VERBOSE);
+	}
+
+    return result;
+}
+
 esp_err_t I2C_FN(_close)(i2c_port_t port) {
 	I2C_PORT_CHECK(port, ESP_FAIL);
     vSemaphoreDelete(I2C_FN(_mutex)[port]);
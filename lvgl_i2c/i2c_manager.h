@@ -42,9 +42,16 @@ extern "C" {
 #define I2C_REG_16  ( 1 << 31 )
 #define I2C_NO_REG  ( 1 << 30 )
 
+// One piece of a write that is sent from where it is, see _writev
+typedef struct {
+    const uint8_t *buffer;
+    uint16_t size;
+} I2C_FN(_segment_t);
+
 esp_err_t I2C_FN(_init)(i2c_port_t port);
 esp_err_t I2C_FN(_read)(i2c_port_t port, uint16_t addr, uint32_t reg, uint8_t *buffer, uint16_t size);
 esp_err_t I2C_FN(_write)(i2c_port_t port, uint16_t addr, uint32_t reg, const uint8_t *buffer, uint16_t size);
+esp_err_t I2C_FN(_writev)(i2c_port_t port, uint16_t addr, const I2C_FN(_segment_t) *segments, uint8_t count);
 esp_err_t I2C_FN(_close)(i2c_port_t port);
 esp_err_t I2C_FN(_lock)(i2c_port_t port);
 esp_err_t I2C_FN(_unlock)(i2c_port_t port);
@@ -146,6 +146,8 @@ extern "C" {
 #define SPI_TFT_CLOCK_SPEED_HZ  (26*1000*1000)
 #elif defined (CONFIG_LV_TFT_DISPLAY_CONTROLLER_SH1107)
 #define SPI_TFT_CLOCK_SPEED_HZ  (8*1000*1000)
+#elif defined (CONFIG_LV_TFT_DISPLAY_CONTROLLER_SSD1306)
+#define SPI_TFT_CLOCK_SPEED_HZ  (10*1000*1000)
 #elif defined (CONFIG_LV_TFT_DISPLAY_CONTROLLER_ILI9481)
 #define SPI_TFT_CLOCK_SPEED_HZ  (16*1000*1000)
 #elif defined (CONFIG_LV_TFT_DISPLAY_CONTROLLER_ILI9486)
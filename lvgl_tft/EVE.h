@@ -49,6 +49,7 @@ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR TH
 #define DL_END			0x21000000UL
 #define DL_BEGIN		0x1F000000UL /* requires OR'd arguments */
 #define DL_DISPLAY		0x00000000UL
+#define DL_NOP			0x2D000000UL
 
 #define CLR_COL              0x4
 #define CLR_STN              0x2
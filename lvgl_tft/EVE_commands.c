@@ -41,6 +41,7 @@ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR TH
 
 
 #include <stdio.h>
+#include <string.h>
 
 #include "EVE.h"
 #include "EVE_commands.h"
@@ -50,6 +51,8 @@ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR TH
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "soc/soc_memory_layout.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 
 #include "esp_log.h"
 
@@ -98,9 +101,17 @@ volatile uint16_t cmdOffset = 0x0000; /* offset for the 4k co-processor FIFO */
 
 volatile uint8_t cmd_burst = 0; /* flag to indicate cmd-burst is active */
 
-// Buffer for SPI transactions
-uint8_t SPIBuffer[SPI_BUFFER_SIZE];				// must be in DMA capable memory if DMA is used!
+static uint16_t cmdSyncOffset = 0x0000; /* how far the co-processor was last seen reading, everything written since may still be pending */
+
+static bool cmdDropped = false;	/* a co-processor fault interrupted the commands being buffered, they are dropped up to the next EVE_cmd_start() */
+static uint16_t cmdDropOffset = 0x0000; /* cmdOffset right after the reset, what was counted since never made it to the fifo */
+
+// Buffers for SPI transactions, one is filled while the other one is sent by DMA
+static uint8_t SPIBuffers[2][SPI_BUFFER_SIZE];	// must be in DMA capable memory if DMA is used!
+uint8_t *SPIBuffer = SPIBuffers[0];
 uint16_t SPIBufferIndex = 0;
+static uint16_t SPIBufferLimit = SPI_BUFFER_SIZE;	// SPIBuffer is sent and continued at the next cmd-fifo address when filled up to here
+static uint16_t SPIBufferCmdOffset = 0;		// cmd-fifo offset the data in SPIBuffer starts at
 disp_spi_send_flag_t SPIInherentSendFlags = 0;	// additional inherent SPI flags (for DIO/QIO mode switching)
 uint8_t SPIDummyReadBits = 0;					// Dummy bits for reading in DIO/QIO modes
 
@@ -108,7 +119,7 @@ uint8_t SPIDummyReadBits = 0;					// Dummy bits for reading in DIO/QIO modes
 // (macros do obscure code a little but they also help code search and readability)
 
 // Buffer a byte
-#define BUFFER_SPI_BYTE(byte) SPIBuffer[SPIBufferIndex++] = (byte);
+#define BUFFER_SPI_BYTE(byte) spi_buffer_byte(byte);
 
 // Buffer a Word - little Endian format
 #define BUFFER_SPI_WORD(word) \
@@ -122,22 +133,147 @@ uint8_t SPIDummyReadBits = 0;					// Dummy bits for reading in DIO/QIO modes
 	BUFFER_SPI_BYTE((uint8_t)((dword) >> 16)) \
 	BUFFER_SPI_BYTE((uint8_t)((dword) >> 24))
 
-// Buffer a 24-bit SPI Memory Write address - big Endian format
-#define BUFFER_SPI_WRITE_ADDRESS(addr) \
-	BUFFER_SPI_BYTE((uint8_t)((addr) >> 16) | MEM_WRITE) \
-	BUFFER_SPI_BYTE((uint8_t)((addr) >> 8)) \
-	BUFFER_SPI_BYTE((uint8_t)(addr))
+// Buffer a 24-bit SPI Memory Write address into the command-fifo - big Endian format
+#define BUFFER_SPI_WRITE_ADDRESS(addr) spi_buffer_start((addr) - EVE_RAM_CMD);
 
 // Send buffer
-#define SEND_SPI_BUFFER() \
-	disp_spi_transaction(SPIBuffer, SPIBufferIndex, (disp_spi_send_flag_t)(DISP_SPI_SEND_QUEUED | SPIInherentSendFlags), NULL, 0, 0); \
-	SPIBufferIndex = 0;
+#define SEND_SPI_BUFFER() spi_buffer_send();
 
 // Wait for DMA queued SPI transactions to complete
 #define WAIT_SPI() \
 	disp_wait_for_pending_transactions();
 
 
+/*
+SPIBuffer only ever holds a stretch of the command-fifo, so it can be sent and continued at any point:
+- when it is full, so commands and strings of any length can be buffered
+- at the end of the 4 kB fifo, as SPI writes do not wrap around
+- when the co-processor has not consumed enough of the fifo yet, it is told to execute what is there and we wait for room
+The two buffers are used in turns, so the next one is filled while the previous one is still on its way.
+*/
+static uint16_t spi_buffer_cmd_pos(void)
+{
+	return (SPIBufferCmdOffset + SPIBufferIndex - 3) & 0x0fff;
+}
+
+
+static uint16_t cmd_fifo_space(uint16_t pos)
+{
+	return ((EVE_CMDFIFO_SIZE) - 4) - ((pos - cmdSyncOffset) & 0x0fff);
+}
+
+
+static void spi_buffer_send(void)
+{
+	if(cmdDropped)
+	{
+		SPIBufferIndex = 0;
+		SPIBufferLimit = SPI_BUFFER_SIZE;
+		return;
+	}
+
+	if(SPIBufferIndex == 0)
+	{
+		return;
+	}
+
+	disp_spi_transaction(SPIBuffer, SPIBufferIndex, (disp_spi_send_flag_t)(DISP_SPI_SEND_QUEUED | SPIInherentSendFlags), NULL, 0, 0);
+	SPIBufferIndex = 0;
+	SPIBufferLimit = SPI_BUFFER_SIZE;
+
+	SPIBuffer = (SPIBuffer == SPIBuffers[0]) ? SPIBuffers[1] : SPIBuffers[0];
+	disp_wait_for_pending_transactions_max(1);	// the buffer sent before has to be out before it is filled again
+}
+
+
+/* A co-processor fault while waiting for room: the command it faulted on and the ones buffered since are incomplete
+   and would fault it again. Reset it and let the rest up to the next EVE_cmd_start() go into SPIBuffer without sending. */
+static void spi_buffer_drop(void)
+{
+	WAIT_SPI();
+	SPIBufferIndex = 0;
+	SPIBufferLimit = SPI_BUFFER_SIZE;
+
+	EVE_reset_coprocessor();
+	ESP_LOGE(TAG_LOG, "co-processor fault, dropping the commands up to the next start");
+
+	cmdDropOffset = cmdOffset;
+	cmdDropped = true;
+	SPIBufferIndex = 3;
+}
+
+
+static void spi_buffer_start(uint32_t offset)
+{
+	uint16_t pos = offset & 0x0fff;
+	uint16_t room = (SPI_BUFFER_SIZE - 3) & ~3;
+	uint16_t space = cmd_fifo_space(pos);
+
+	if(cmdDropped)
+	{
+		SPIBufferIndex = 3;
+		SPIBufferLimit = SPI_BUFFER_SIZE;
+		return;
+	}
+
+	if(space < room)
+	{
+		// let the co-processor work through what is there, REG_CMD_WRITE may point into the middle of a command
+		WAIT_SPI();
+		EVE_memWrite16(REG_CMD_WRITE, pos);
+
+		while(space < room)
+		{
+			uint16_t rd = EVE_memRead16(REG_CMD_READ);
+			if(rd == 0xfff)
+			{
+				spi_buffer_drop();
+				return;
+			}
+			cmdSyncOffset = rd;
+			space = cmd_fifo_space(pos);
+		}
+	}
+
+	if(room > (EVE_CMDFIFO_SIZE) - pos)
+	{
+		room = (EVE_CMDFIFO_SIZE) - pos;
+	}
+	if(room > space)
+	{
+		room = space;
+	}
+
+	uint32_t addr = EVE_RAM_CMD + pos;
+	SPIBuffer[0] = (uint8_t)(addr >> 16) | MEM_WRITE;
+	SPIBuffer[1] = (uint8_t)(addr >> 8);
+	SPIBuffer[2] = (uint8_t)(addr);
+	SPIBufferIndex = 3;
+	SPIBufferLimit = 3 + room;
+	SPIBufferCmdOffset = pos;
+}
+
+
+static void spi_buffer_continue(void)
+{
+	uint16_t pos = spi_buffer_cmd_pos();
+
+	spi_buffer_send();
+	spi_buffer_start(pos);
+}
+
+
+static inline void spi_buffer_byte(uint8_t byte)
+{
+	if(SPIBufferIndex >= SPIBufferLimit)
+	{
+		spi_buffer_continue();
+	}
+
+	SPIBuffer[SPIBufferIndex++] = byte;
+}
+
+
 
 void DELAY_MS(uint16_t ms)
 {
@@ -247,6 +383,35 @@ uint32_t EVE_memRead32(uint32_t ftAddress)
 }
 
 
+// read "len" bytes in one go, e.g. a block of registers
+void EVE_memRead_buffer(uint32_t ftAddress, uint8_t *data, uint32_t len)
+{
+#if defined(DISP_SPI_HALF_DUPLEX)
+	// same esp32 issue as above, bytes have to be read one at a time
+	for(uint32_t i = 0; i < len; i++)
+	{
+		data[i] = EVE_memRead8(ftAddress + i);
+	}
+	return;
+#endif
+
+	static uint8_t buf[SPI_READ_DUMMY_LEN + 64] __attribute__((aligned(4)));	// DMA reads come in dwords, this also takes the dummy byte
+	disp_spi_send_flag_t readflags = (disp_spi_send_flag_t)(DISP_SPI_RECEIVE | DISP_SPI_SEND_POLLING | DISP_SPI_ADDRESS_24 | SPIInherentSendFlags);
+
+	while(len > 0)
+	{
+		uint32_t chunk = (len > 64) ? 64 : len;
+
+		disp_spi_transaction(NULL, SPI_READ_DUMMY_LEN + chunk, readflags, buf, ftAddress, SPIDummyReadBits);
+		memcpy(data, &buf[SPI_READ_DUMMY_LEN], chunk);
+
+		data += chunk;
+		ftAddress += chunk;
+		len -= chunk;
+	}
+}
+
+
 void EVE_memWrite8(uint32_t ftAddress, uint8_t ftData8)
 {
 	disp_spi_transaction(&ftData8, sizeof(ftData8), (disp_spi_send_flag_t)(DISP_SPI_SEND_POLLING | DISP_SPI_ADDRESS_24 | SPIInherentSendFlags), NULL, (ftAddress | MEM_WRITE_24), 0);
@@ -290,63 +455,65 @@ void EVE_memWrite_buffer(uint32_t ftAddress, const uint8_t *data, uint32_t len,
 }
 
 
-/* Check if the graphics processor completed executing the current command list. */
-/* This is the case when REG_CMD_READ matches cmdOffset, indicating that all commands have been executed. */
-uint8_t EVE_busy(void)
+/* Hold the co-processor in reset, clear the command-fifo and restart it, after a fault or to abort a command */
+/* that waits for data which never comes, e.g. CMD_LOADIMAGE from a truncated media-fifo stream */
+void EVE_reset_coprocessor(void)
 {
-	uint16_t cmdBufferRead;
+	#if defined (BT81X_ENABLE)
 
-	WAIT_SPI();	// can't tell if EVE is busy if SPI is taking place
+	uint16_t copro_patch_pointer;
 
-	cmdBufferRead = EVE_memRead16(REG_CMD_READ); /* read the graphics processor read pointer */
+	copro_patch_pointer = EVE_memRead16(REG_COPRO_PATCH_DTR);
 
-	if(cmdBufferRead == 0xFFF) /* we have a co-processor fault, make EVE play with us again */
-	{
-		#if defined (BT81X_ENABLE)
+	#endif
 
-		uint16_t copro_patch_pointer;
+	EVE_memWrite8(REG_CPURESET, 1);   /* hold co-processor engine in the reset condition */
+	EVE_memWrite16(REG_CMD_READ, 0);  /* set REG_CMD_READ to 0 */
+	EVE_memWrite16(REG_CMD_WRITE, 0); /* set REG_CMD_WRITE to 0 */
+	EVE_memWrite32(REG_CMD_DL, 0);    /* reset REG_CMD_DL to 0 as required by the BT81x programming guide, should not hurt FT8xx */
+	cmdOffset = 0;
+	cmdSyncOffset = 0;
+	EVE_memWrite8(REG_CPURESET, 0);  /* set REG_CMD_WRITE to 0 to restart the co-processor engine*/
 
-		copro_patch_pointer = EVE_memRead16(REG_COPRO_PATCH_DTR);
+	#if defined (BT81X_ENABLE)
 
-		#endif
+	EVE_memWrite16(REG_COPRO_PATCH_DTR, copro_patch_pointer);
 
-		EVE_memWrite8(REG_CPURESET, 1);   /* hold co-processor engine in the reset condition */
-		EVE_memWrite16(REG_CMD_READ, 0);  /* set REG_CMD_READ to 0 */
-		EVE_memWrite16(REG_CMD_WRITE, 0); /* set REG_CMD_WRITE to 0 */
-		EVE_memWrite32(REG_CMD_DL, 0);    /* reset REG_CMD_DL to 0 as required by the BT81x programming guide, should not hurt FT8xx */
-		cmdOffset = 0;
-		EVE_memWrite8(REG_CPURESET, 0);  /* set REG_CMD_WRITE to 0 to restart the co-processor engine*/
+	DELAY_MS(5); /* just to be safe */
 
-		#if defined (BT81X_ENABLE)
+	// reset the SPI buffer just to be cautious
+	SPIBufferIndex = 0;
 
-		EVE_memWrite16(REG_COPRO_PATCH_DTR, copro_patch_pointer);
+	BUFFER_SPI_WRITE_ADDRESS(EVE_RAM_CMD + cmdOffset)
+	BUFFER_SPI_DWORD(CMD_FLASHATTACH)
+	BUFFER_SPI_DWORD(CMD_FLASHFAST)
+	SEND_SPI_BUFFER()
 
-		DELAY_MS(5); /* just to be safe */
+	cmdOffset += 8;
 
-		// reset the SPI buffer just to be cautious
-		SPIBufferIndex = 0;
+	EVE_memWrite16(REG_CMD_WRITE, cmdOffset);
 
-		BUFFER_SPI_WRITE_ADDRESS(EVE_RAM_CMD + cmdOffset)
-		BUFFER_SPI_DWORD(CMD_FLASHATTACH)
-		BUFFER_SPI_DWORD(CMD_FLASHFAST)
-		SEND_SPI_BUFFER()
-		WAIT_SPI()
+	EVE_memWrite8(REG_PCLK, EVE_PCLK); /* restore REG_PCLK in case it was set to zero by an error */
 
-		cmdOffset += 8;
+	DELAY_MS(5); /* just to be safe */
 
-		BUFFER_SPI_BYTE
-		BUFFER_SPI_BYTE(MEM_WRITE | 0x30); /* send Memory Write plus high address byte of REG_CMD_WRITE for EVE81x */
-		BUFFER_SPI_BYTE(0x20);	/* send middle address byte of REG_CMD_WRITE for EVE81x */
-		BUFFER_SPI_BYTE(0xfc);	/* send low address byte of REG_CMD_WRITE for EVE81x */
-		BUFFER_SPI_WORD(cmdOffset);
-		SEND_SPI_BUFFER()
-		WAIT_SPI()
+	#endif
+}
 
-		EVE_memWrite8(REG_PCLK, EVE_PCLK); /* restore REG_PCLK in case it was set to zero by an error */
 
-		DELAY_MS(5); /* just to be safe */
+/* Check if the graphics processor completed executing the current command list. */
+/* This is the case when REG_CMD_READ matches cmdOffset, indicating that all commands have been executed. */
+uint8_t EVE_busy(void)
+{
+	uint16_t cmdBufferRead;
+
+	WAIT_SPI();	// can't tell if EVE is busy if SPI is taking place
 
-		#endif
+	cmdBufferRead = EVE_memRead16(REG_CMD_READ); /* read the graphics processor read pointer */
+
+	if(cmdBufferRead == 0xFFF) /* we have a co-processor fault, make EVE play with us again */
+	{
+		EVE_reset_coprocessor();
 	}
 
 	if(cmdOffset != cmdBufferRead)
@@ -355,6 +522,7 @@ uint8_t EVE_busy(void)
 	}
 	else
 	{
+		cmdSyncOffset = cmdOffset;
 		return 0;
 	}
 }
@@ -363,6 +531,7 @@ uint8_t EVE_busy(void)
 void EVE_get_cmdoffset(void)
 {
 	cmdOffset = EVE_memRead16(REG_CMD_WRITE);
+	cmdSyncOffset = cmdOffset;
 }
 
 
@@ -378,6 +547,12 @@ void EVE_cmd_start(void)
 {
 	WAIT_SPI();
 
+	if(cmdDropped)
+	{
+		cmdDropped = false;
+		cmdOffset = cmdDropOffset;
+	}
+
 	EVE_memWrite16(REG_CMD_WRITE, cmdOffset);
 }
 
@@ -500,6 +675,10 @@ void block_transfer(const uint8_t *data, uint32_t len)
 	{
 		uint32_t block_len;
 		block_len = (bytes_left > BLOCK_TRANSFER_SIZE ? BLOCK_TRANSFER_SIZE : bytes_left);
+		if(block_len > ((EVE_CMDFIFO_SIZE) - cmdOffset))
+		{
+			block_len = (EVE_CMDFIFO_SIZE) - cmdOffset;	// SPI writes do not wrap around at the end of the fifo
+		}
 
 		eve_spi_CMD_write(EVE_RAM_CMD + cmdOffset, data, block_len);
 
@@ -580,6 +759,24 @@ void EVE_cmd_mediafifo(uint32_t ptr, uint32_t size)
 
 	SEND_SPI_BUFFER()
 }
+
+
+/* this is meant to be called outside display-list building, does not support cmd-burst */
+/* with EVE_OPT_MEDIAFIFO the video is read from the media-fifo and the command finishes when the video is done */
+void EVE_cmd_playvideo(uint32_t options, const uint8_t *data, uint32_t len)
+{
+	EVE_begin_cmd(CMD_PLAYVIDEO);
+	BUFFER_SPI_DWORD(options)
+
+	EVE_inc_cmdoffset(4);
+
+	SEND_SPI_BUFFER()
+
+	if((options & EVE_OPT_MEDIAFIFO) == 0) /* direct data, not by Media-FIFO */
+	{
+		block_transfer(data, len);	// block_transfer is immediate - make sure CMD buffer is prepared!
+	}
+}
 #endif
 
 
@@ -835,6 +1032,158 @@ const uint8_t EVE_GT911_data[1184] PROGMEM =
 #endif // FT81X_FULL
 
 
+#if defined (CONFIG_LV_FT81X_SPI_PROBE)
+
+/*
+Find the fastest SPI width and clock the board handles reliably.
+A test pattern is written to RAM_G in every mode the build allows and checked with CMD_MEMCRC against the CRC of the
+pattern written in SIO at a slow clock, the mode with the best throughput wins. The width is always switched at the
+slow clock and verified by reading REG_ID, so a mode that fails at speed does not lock us out.
+*/
+#define PROBE_ADDR		0		// start of RAM_G, it is overwritten by the application later on
+#define PROBE_LEN		8192
+#define PROBE_REPEAT	4
+#define PROBE_CLOCK_MIN	(10 * 1000 * 1000)
+#define PROBE_CLOCK_SAFE	PROBE_CLOCK_MIN
+
+typedef struct {
+	const char *name;
+	uint8_t width;
+	disp_spi_send_flag_t flags;
+	uint8_t dummy_bits;	/* Esp32 DMA SPI transaction dummy_bits works more like clock cycles, see above */
+} spi_mode_t;
+
+static const spi_mode_t spi_modes[] = {
+#if defined(DISP_SPI_TRANS_MODE_QIO)
+	{"QIO", SPI_WIDTH_QIO, DISP_SPI_MODE_QIO | DISP_SPI_MODE_DIOQIO_ADDR, 2},
+#endif
+#if defined(DISP_SPI_TRANS_MODE_QIO) || defined(DISP_SPI_TRANS_MODE_DIO)
+	{"DIO", SPI_WIDTH_DIO, DISP_SPI_MODE_DIO | DISP_SPI_MODE_DIOQIO_ADDR, 4},
+#endif
+#if defined(DISP_SPI_HALF_DUPLEX)
+	{"SIO", SPI_WIDTH_SIO, 0, 8},
+#else
+	{"SIO", SPI_WIDTH_SIO, 0, 0},
+#endif
+};
+
+#define SPI_MODE_SIO	(sizeof(spi_modes) / sizeof(spi_modes[0]) - 1)
+
+
+static bool spi_mode_set(const spi_mode_t *mode)
+{
+	EVE_memWrite16(REG_SPI_WIDTH, mode->width);
+	SPIInherentSendFlags = mode->flags;
+	SPIDummyReadBits = mode->dummy_bits;
+
+	return (EVE_memRead8(REG_ID) == 0x7C);
+}
+
+
+// bytes per second, 0 if the pattern did not arrive intact
+static uint32_t spi_probe_run(const uint8_t *pattern, uint32_t crc)
+{
+	int64_t start = esp_timer_get_time();
+
+	for(uint8_t i = 0; i < PROBE_REPEAT; i++)
+	{
+		EVE_memWrite_buffer(EVE_RAM_G + PROBE_ADDR, pattern, PROBE_LEN, false);
+	}
+	WAIT_SPI();
+
+	int64_t us = esp_timer_get_time() - start;
+
+	if(EVE_memRead8(REG_ID) != 0x7C || EVE_cmd_memcrc(EVE_RAM_G + PROBE_ADDR, PROBE_LEN) != crc)
+	{
+		return 0;
+	}
+
+	return (uint32_t)(((int64_t) PROBE_LEN * PROBE_REPEAT * 1000000LL) / (us > 0 ? us : 1));
+}
+
+
+static void EVE_spi_probe(void)
+{
+	uint8_t *pattern = heap_caps_malloc(PROBE_LEN, MALLOC_CAP_DMA);
+	if(pattern == NULL)
+	{
+		ESP_LOGW(TAG_LOG, "SPI probe: no memory, staying in SIO");
+		return;
+	}
+
+	uint32_t seed = 0x2545F491UL;
+	for(uint32_t i = 0; i < PROBE_LEN; i++)
+	{
+		seed ^= seed << 13;	// xorshift, every bit pattern shows up on the lines
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		pattern[i] = (uint8_t) seed;
+	}
+
+	disp_spi_change_device_speed(PROBE_CLOCK_SAFE);
+	EVE_memWrite_buffer(EVE_RAM_G + PROBE_ADDR, pattern, PROBE_LEN, false);
+	WAIT_SPI();
+	uint32_t crc = EVE_cmd_memcrc(EVE_RAM_G + PROBE_ADDR, PROBE_LEN);
+
+	uint8_t best = SPI_MODE_SIO;
+	int best_clock = PROBE_CLOCK_SAFE;
+	uint32_t best_rate = 0;
+
+	for(uint8_t m = 0; m < (sizeof(spi_modes) / sizeof(spi_modes[0])); m++)
+	{
+		if(!spi_mode_set(&spi_modes[m]))
+		{
+			ESP_LOGW(TAG_LOG, "SPI probe: %s does not respond", spi_modes[m].name);
+			spi_mode_set(&spi_modes[SPI_MODE_SIO]);
+			continue;
+		}
+
+		// the fastest clock that works in this mode, 80 MHz / n from the configured clock down
+		for(int div = (80 * 1000 * 1000) / SPI_TFT_CLOCK_SPEED_HZ; ((80 * 1000 * 1000) / div) >= PROBE_CLOCK_MIN; div++)
+		{
+			int clock = (80 * 1000 * 1000) / div;
+
+			disp_spi_change_device_speed(clock);
+			uint32_t rate = spi_probe_run(pattern, crc);
+
+			if(rate)
+			{
+				ESP_LOGI(TAG_LOG, "SPI probe: %s at %d MHz, %u kB/s", spi_modes[m].name, clock / 1000000, (unsigned)(rate / 1000));
+				if(rate > best_rate)
+				{
+					best = m;
+					best_clock = clock;
+					best_rate = rate;
+				}
+				break;
+			}
+		}
+
+		disp_spi_change_device_speed(PROBE_CLOCK_SAFE);
+		if(m != SPI_MODE_SIO && !spi_mode_set(&spi_modes[SPI_MODE_SIO]))
+		{
+			// can not get back, the mode we are stuck in has to do
+			ESP_LOGE(TAG_LOG, "SPI probe: failed to switch back from %s", spi_modes[m].name);
+			spi_mode_set(&spi_modes[m]);
+			best = m;
+			best_clock = PROBE_CLOCK_SAFE;
+			break;
+		}
+	}
+
+	if(best != SPI_MODE_SIO)
+	{
+		spi_mode_set(&spi_modes[best]);
+	}
+	disp_spi_change_device_speed(best_clock);
+
+	ESP_LOGI(TAG_LOG, "SPI probe: using %s at %d MHz", spi_modes[best].name, best_clock / 1000000);
+	heap_caps_free(pattern);
+}
+
+#endif /* CONFIG_LV_FT81X_SPI_PROBE */
+
+
 /* init, has to be executed with the SPI setup to 11 MHz or less as required by FT8xx / BT8xx */
 uint8_t EVE_init(void)
 {
@@ -874,7 +1223,12 @@ uint8_t EVE_init(void)
 	DELAY_MS(40);
 
 	/* The most reliable DIO/QIO switching point is after EVE start up but before reading the ChipID. */
-#if defined(DISP_SPI_TRANS_MODE_DIO)
+#if defined (CONFIG_LV_FT81X_SPI_PROBE)
+	/* the width is set by EVE_spi_probe() once EVE is up */
+#if defined(DISP_SPI_HALF_DUPLEX)
+	SPIDummyReadBits = 8;	/* SIO half-duplex mode */
+#endif
+#elif defined(DISP_SPI_TRANS_MODE_DIO)
 	ESP_LOGI(TAG_LOG, "Switching to DIO mode");
 	DELAY_MS(20);	/* different boards may take a different delay but this generally seems to work */
 	EVE_memWrite16(REG_SPI_WIDTH, SPI_WIDTH_DIO);
@@ -919,6 +1273,10 @@ uint8_t EVE_init(void)
 	EVE_memWrite32(REG_FREQUENCY, 72000000);
 #endif
 
+#if defined (CONFIG_LV_FT81X_SPI_PROBE)
+	EVE_spi_probe();
+#endif
+
 	/* we have a display with a Goodix GT911 / GT9271 touch-controller on it, so we patch our FT811 or FT813 according to AN_336 or setup a BT815 accordingly */
 #if defined (EVE_HAS_GT911)
 
@@ -1027,8 +1385,7 @@ void EVE_start_cmd_burst(void)
 {
 	cmd_burst = 42;
 
-	WAIT_SPI()	// it is important to wait before writing to the SPI buffer as it might be in a DMA transaction
-	BUFFER_SPI_WRITE_ADDRESS(EVE_RAM_CMD + cmdOffset)
+	BUFFER_SPI_WRITE_ADDRESS(EVE_RAM_CMD + cmdOffset)	// SPIBuffer is never the one in a DMA transaction, no need to wait
 }
 
 
@@ -1045,7 +1402,6 @@ void EVE_start_cmd(uint32_t command)
 {
 	if(!cmd_burst)
 	{
-		WAIT_SPI()	// it is important to wait before writing to the SPI buffer as it might be in a DMA transaction
 		BUFFER_SPI_WRITE_ADDRESS(EVE_RAM_CMD + cmdOffset)
 	}
 
@@ -1093,7 +1449,7 @@ void EVE_write_string(const char *text)
 	{
 		BUFFER_SPI_BYTE(bytes[textindex]);
 		textindex++;
-		if(textindex > 249 || SPIBufferIndex >= SPI_BUFFER_SIZE) /* there appears to be no end for the "string", or no more room in SPI buffer, so leave */
+		if(textindex > 249) /* there appears to be no end for the "string", so leave */
 		{
 			break;
 		}
@@ -1104,7 +1460,7 @@ void EVE_write_string(const char *text)
 	padding = 4-padding; /* 4, 3, 2 or 1 */
 	textindex += padding;
 
-	while(padding > 0 && SPIBufferIndex < SPI_BUFFER_SIZE)
+	while(padding > 0)
 	{
 		BUFFER_SPI_BYTE(0);
 		padding--;
@@ -1908,7 +2264,7 @@ void EVE_cmd_rotatearound(int32_t x0, int32_t y0, int32_t angle, int32_t scale)
 	EVE_start_cmd(CMD_ROTATEAROUND);
 	BUFFER_SPI_DWORD(x0)
 	BUFFER_SPI_DWORD(y0)
-	BUFFER_SPI_DWORD(ang)
+	BUFFER_SPI_DWORD(angle)
 	BUFFER_SPI_DWORD(scale)
 
 	EVE_inc_cmdoffset(16);
@@ -53,6 +53,7 @@ void EVE_cmdWrite(uint8_t command, uint8_t parameter);
 uint8_t EVE_memRead8(uint32_t ftAddress);
 uint16_t EVE_memRead16(uint32_t ftAddress);
 uint32_t EVE_memRead32(uint32_t ftAddress);
+void EVE_memRead_buffer(uint32_t ftAddress, uint8_t *data, uint32_t len);
 
 void EVE_memWrite8(uint32_t ftAddress, uint8_t ftData8);
 void EVE_memWrite16(uint32_t ftAddress, uint16_t ftData16);
@@ -61,6 +62,7 @@ void EVE_memWrite32(uint32_t ftAddress, uint32_t ftData32);
 void EVE_memWrite_buffer(uint32_t ftAddress, const uint8_t *data, uint32_t len, bool LvGL_Flush);
 
 uint8_t EVE_busy(void);
+void EVE_reset_coprocessor(void);
 
 void EVE_get_cmdoffset(void);
 
@@ -78,6 +80,7 @@ void EVE_cmd_loadimage(uint32_t ptr, uint32_t options, const uint8_t *data, uint
 
 #if defined (FT81X_ENABLE)
 void EVE_cmd_mediafifo(uint32_t ptr, uint32_t size);
+void EVE_cmd_playvideo(uint32_t options, const uint8_t *data, uint32_t len);
 #endif
 #endif // FT81X_FULL
 
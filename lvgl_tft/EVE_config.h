@@ -59,6 +59,10 @@ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR TH
 
 #define SPI_BUFFER_SIZE 256				// size in bytes (multiples of 4) of SPI transaction buffer for streaming commands
 
+#if defined (CONFIG_LV_FT81X_DL_RENDERER) || defined (CONFIG_LV_FT81X_MEDIA) || defined (CONFIG_LV_FT81X_SPI_PROBE)
+#define FT81X_FULL	1					// the display-list renderer uses CMD_GRADIENT and the matrix commands, media streaming CMD_LOADIMAGE, the SPI probe CMD_MEMCRC
+#endif
+
 /* select the settings for the TFT attached */
 #if 0
 	#define EVE_VM800B35A
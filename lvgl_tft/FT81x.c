@@ -23,8 +23,34 @@
 /* memory-map defines */
 #define SCREEN_BITMAP_ADDR	0x00000000	// full screen buffer (0x00000000 - 0x000‭‭BBE40‬)
 
+#if defined (CONFIG_LV_FT81X_DOUBLE_BUFFER) && ((2 * SCREEN_BUFFER_SIZE) <= EVE_RAM_G_SIZE)
+#define SCREEN_BUFFERS		2
+#define SCREEN_BITMAP_ADDR2	(SCREEN_BITMAP_ADDR + SCREEN_BUFFER_SIZE)	// second screen buffer right behind the first
+#define DIRTY_AREAS_MAX		16
+#else
+#define SCREEN_BUFFERS		1
+#endif
+
+#if defined (CONFIG_LV_FT81X_DOUBLE_BUFFER) && (SCREEN_BUFFERS == 1)
+#warning "two screen buffers do not fit into RAM_G at this resolution, using a single buffer"
+#endif
+
+// partial width flushes are staged in the rest of RAM_G behind the screen buffers
+#define STAGING_ADDR		(SCREEN_BITMAP_ADDR + (SCREEN_BUFFERS * SCREEN_BUFFER_SIZE))
+#define STAGING_SIZE		(EVE_RAM_G_SIZE - STAGING_ADDR)
+
 uint8_t tft_active = 0;
 
+static uint32_t screen_front = SCREEN_BITMAP_ADDR;	// bitmap that is scanned out
+static uint32_t screen_back = SCREEN_BITMAP_ADDR;	// bitmap that flushes write to
+
+#if SCREEN_BUFFERS == 2
+static lv_area_t dirty[DIRTY_AREAS_MAX];	// areas flushed since the last flip
+static uint8_t dirty_cnt = 0;
+static bool swap_pending = false;
+static uint32_t swap_frames;
+#endif
+
 void touch_calibrate(void)
 {
 
@@ -242,7 +268,7 @@ void TFT_bitmap_display(void)
 
 		// fullscreen bitmap for memory-mapped direct access
 		EVE_cmd_dl(TAG(20));
-		EVE_cmd_setbitmap(SCREEN_BITMAP_ADDR, EVE_RGB565, EVE_HSIZE, EVE_VSIZE);
+		EVE_cmd_setbitmap(screen_front, EVE_RGB565, EVE_HSIZE, EVE_VSIZE);
 		EVE_cmd_dl(DL_BEGIN | EVE_BITMAPS);
 		EVE_cmd_dl(VERTEX2F(0, 0));
 		EVE_cmd_dl(DL_END);
@@ -283,6 +309,10 @@ void FT81x_init(void)
 		touch_calibrate();
 
 		EVE_cmd_memset(SCREEN_BITMAP_ADDR, BLACK, SCREEN_BUFFER_SIZE);		// clear screen buffer
+#if SCREEN_BUFFERS == 2
+		EVE_cmd_memset(SCREEN_BITMAP_ADDR2, BLACK, SCREEN_BUFFER_SIZE);
+		screen_back = SCREEN_BITMAP_ADDR2;
+#endif
 		EVE_cmd_execute();
 
 		TFT_bitmap_display();	// set DL for fullscreen bitmap display
@@ -295,7 +325,7 @@ void FT81x_init(void)
 // write fullscreen bitmap directly
 void TFT_WriteScreen(uint8_t* Bitmap)
 {
-	EVE_memWrite_buffer(SCREEN_BITMAP_ADDR, Bitmap, SCREEN_BUFFER_SIZE, false);
+	EVE_memWrite_buffer(screen_back, Bitmap, SCREEN_BUFFER_SIZE, false);
 }
 
 
@@ -303,17 +333,36 @@ void TFT_WriteScreen(uint8_t* Bitmap)
 void TFT_WriteBitmap(uint8_t* Bitmap, uint16_t X, uint16_t Y, uint16_t Width, uint16_t Height)
 {
 	// calc base address
-	uint32_t addr = SCREEN_BITMAP_ADDR + (Y * BYTES_PER_LINE) + (X * BYTES_PER_PIXEL);
+	uint32_t addr = screen_back + (Y * BYTES_PER_LINE) + (X * BYTES_PER_PIXEL);
+	uint32_t bpl = Width * BYTES_PER_PIXEL;
 
 	// can we do a fast full width block transfer?
 	if(X == 0 && Width == EVE_HSIZE)
 	{
 		EVE_memWrite_buffer(addr, Bitmap, (Height * BYTES_PER_LINE), true);
 	}
+	else if((Height * bpl) <= STAGING_SIZE)
+	{
+		// one block transfer to the staging area, the co-processor puts the lines in place
+		while(EVE_busy());	// the lines of the previous flush have to be out of the staging area
+
+		EVE_memWrite_buffer(STAGING_ADDR, Bitmap, (Height * bpl), true);
+
+		EVE_start_cmd_burst();
+		for (uint16_t i = 0; i < Height; i++)
+		{
+			EVE_cmd_dl(CMD_MEMCPY);
+			EVE_cmd_dl(addr);
+			EVE_cmd_dl(STAGING_ADDR + (i * bpl));
+			EVE_cmd_dl(bpl);
+			addr += BYTES_PER_LINE;
+		}
+		EVE_end_cmd_burst();
+		EVE_cmd_start();
+	}
 	else
 	{
 		// line by line mode
-		uint32_t bpl = Width * BYTES_PER_PIXEL;
 		for (uint16_t i = 0; i < Height; i++)
 		{
 			EVE_memWrite_buffer(addr, Bitmap + (i * bpl), bpl, (i == Height - 1));
@@ -322,8 +371,112 @@ void TFT_WriteBitmap(uint8_t* Bitmap, uint16_t X, uint16_t Y, uint16_t Width, ui
 	}
 }
 
+#if SCREEN_BUFFERS == 2
+static void dirty_add(const lv_area_t * area)
+{
+	if(dirty_cnt < DIRTY_AREAS_MAX)
+	{
+		lv_area_copy(&dirty[dirty_cnt++], area);
+		return;
+	}
+
+	// out of slots, grow the last one to cover the new area as well
+	lv_area_t * last = &dirty[DIRTY_AREAS_MAX - 1];
+	last->x1 = LV_MIN(last->x1, area->x1);
+	last->y1 = LV_MIN(last->y1, area->y1);
+	last->x2 = LV_MAX(last->x2, area->x2);
+	last->y2 = LV_MAX(last->y2, area->y2);
+}
+
+
+// show the back buffer, CMD_SWAP takes effect at the start of the next frame
+static void screen_flip(void)
+{
+	uint32_t shown = screen_back;
+
+	screen_back = screen_front;
+	screen_front = shown;
+
+	TFT_bitmap_display();
+	EVE_cmd_execute();
+
+	swap_frames = EVE_memRead32(REG_FRAMES);
+	swap_pending = true;
+}
+
+
+/* before the first write into the new back buffer, wait for the flip to happen and copy what was flushed */
+/* into the other buffer since the last flip, the co-processor copies from RAM_G to RAM_G much faster than SPI */
+static void screen_sync(void)
+{
+	if(!swap_pending)
+	{
+		return;
+	}
+
+	while(EVE_memRead32(REG_FRAMES) == swap_frames);
+
+	EVE_start_cmd_burst();
+
+	for(uint8_t i = 0; i < dirty_cnt; i++)
+	{
+		uint32_t offset = (dirty[i].y1 * BYTES_PER_LINE) + (dirty[i].x1 * BYTES_PER_PIXEL);
+		uint32_t bpl = lv_area_get_width(&dirty[i]) * BYTES_PER_PIXEL;
+		uint16_t lines = lv_area_get_height(&dirty[i]);
+
+		// full width areas are a single block
+		if(bpl == BYTES_PER_LINE)
+		{
+			bpl *= lines;
+			lines = 1;
+		}
+
+		for(uint16_t line = 0; line < lines; line++)
+		{
+			EVE_cmd_dl(CMD_MEMCPY);
+			EVE_cmd_dl(screen_back + offset);
+			EVE_cmd_dl(screen_front + offset);
+			EVE_cmd_dl(bpl);
+			offset += BYTES_PER_LINE;
+		}
+	}
+
+	EVE_end_cmd_burst();
+	EVE_cmd_execute();	// the copies have to be done before new pixels arrive
+
+	dirty_cnt = 0;
+	swap_pending = false;
+}
+#endif
+
+
 // LittlevGL flush callback
 void FT81x_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_map)
 {
+#if defined (CONFIG_LV_FT81X_DL_RENDERER)
+	// the draw callbacks already built the display-list, there are no pixels to send
+	if(drv->draw_ctx_init == FT81x_draw_ctx_init)
+	{
+		if(lv_disp_flush_is_last(drv))
+		{
+			FT81x_draw_frame_end();
+		}
+		lv_disp_flush_ready(drv);
+		return;
+	}
+#endif
+
+#if SCREEN_BUFFERS == 2
+	screen_sync();
+	dirty_add(area);
+#endif
+
 	TFT_WriteBitmap((uint8_t*)color_map, area->x1, area->y1, lv_area_get_width(area), lv_area_get_height(area));
+
+#if SCREEN_BUFFERS == 2
+	if(lv_disp_flush_is_last(drv))
+	{
+		screen_flip();
+	}
+#endif
 }
@@ -10,6 +10,12 @@
 #endif
 #include "../lvgl_helpers.h"
 
+#if defined (CONFIG_LV_FT81X_DL_RENDERER)
+#include "FT81x_draw.h"
+#endif
+
+extern uint8_t tft_active;
+
 void FT81x_init(void);
 
 void FT81x_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_map);
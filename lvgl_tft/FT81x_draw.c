@@ -0,0 +1,1633 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "soc/soc_memory_layout.h"
+
+#include "FT81x.h"
+#include "FT81x_draw.h"
+#include "FT81x_ramg.h"
+#include "FT81x_flash.h"
+
+#include "EVE.h"
+#include "EVE_commands.h"
+
+#include "disp_spi.h"
+
+#if !(LVGL_VERSION_MAJOR > 8 || (LVGL_VERSION_MAJOR == 8 && LVGL_VERSION_MINOR >= 3))
+#error "CONFIG_LV_FT81X_DL_RENDERER needs the draw context API of LvGL 8.3 or newer"
+#endif
+
+#if LV_COLOR_DEPTH != 16
+#error "CONFIG_LV_FT81X_DL_RENDERER needs LV_COLOR_DEPTH 16"
+#endif
+
+#define LOG_TAG "FT81x_draw"
+
+#define DL_WORDS_MAX	((EVE_RAM_DL_SIZE) / 4 - 8)	// keep some room for DISPLAY at the end of the list
+
+#define IMG_HANDLE		0	// bitmap handle for images, fonts use 1 to 14 and 15 is the co-processor scratch handle
+#define FONT_HANDLE_MIN	1
+#define FONT_HANDLE_MAX	14
+
+// images that can not be cached go to the RAM_G scratch, frames use the two halves alternately
+#define SCRATCH_HALF	(FT81X_RAMG_SCRATCH_SIZE / 2)
+
+#define SHADOW_STEPS	4
+
+#define SNIPPETS_MAX	8
+
+// all vertices are sent in 1/2 pixel units, see VERTEX_FORMAT(1) in frame_begin()
+#define VTX(x, y)		VERTEX2F((x) * 2, (y) * 2)
+
+#define F16(x)			((int32_t)(x) * 65536L)
+
+typedef struct {
+	lv_draw_sw_ctx_t base_draw;	// software renderer, still used for everything LvGL draws into layers
+	lv_disp_drv_t * drv;
+	void (*sw_draw_rect)(lv_draw_ctx_t * draw_ctx, const lv_draw_rect_dsc_t * dsc, const lv_area_t * coords);
+	void (*sw_draw_bg)(lv_draw_ctx_t * draw_ctx, const lv_draw_rect_dsc_t * dsc, const lv_area_t * coords);
+	void (*sw_draw_arc)(lv_draw_ctx_t * draw_ctx, const lv_draw_arc_dsc_t * dsc, const lv_point_t * center, uint16_t radius, uint16_t start_angle, uint16_t end_angle);
+	void (*sw_draw_img_decoded)(lv_draw_ctx_t * draw_ctx, const lv_draw_img_dsc_t * dsc, const lv_area_t * coords, const uint8_t * map_p, lv_img_cf_t color_format);
+	void (*sw_draw_letter)(lv_draw_ctx_t * draw_ctx, const lv_draw_label_dsc_t * dsc, const lv_point_t * pos_p, uint32_t letter);
+	void (*sw_draw_line)(lv_draw_ctx_t * draw_ctx, const lv_draw_line_dsc_t * dsc, const lv_point_t * point1, const lv_point_t * point2);
+	void (*sw_draw_polygon)(lv_draw_ctx_t * draw_ctx, const lv_draw_rect_dsc_t * dsc, const lv_point_t * points, uint16_t point_cnt);
+} FT81x_draw_ctx_t;
+
+// display-list state that was already sent, to skip redundant commands
+typedef struct {
+	uint32_t color;
+	int16_t opa;
+	uint16_t line_width;
+	lv_area_t clip;
+} dl_state_t;
+
+enum {
+	SNIPPET_CHANGED,	// invalidated since it was last drawn
+	SNIPPET_SETTLED,	// drawn once without being invalidated since, worth recording
+	SNIPPET_RECORDED,
+	SNIPPET_FAILED,		// could not be recorded, drawn normally until it changes
+};
+
+// display-list commands of an object and its children, recorded into RAM_G and replayed with CMD_APPEND
+typedef struct {
+	lv_obj_t * obj;
+	uint32_t addr;
+	uint32_t len;
+	lv_area_t coords;	// geometry the snippet was recorded for
+	lv_area_t area;		// part of the screen the object last drew to, invalidations there drop the recording
+	uint8_t state;
+} snippet_t;
+
+typedef struct {
+	bool open;
+	bool overflow;
+	bool rec_volatile;	// the snippet being recorded uses RAM_G data that does not stay in place
+	bool swap_done;		// the list from two frames ago is off the screen, its scratch half can be overwritten
+	uint8_t prim;
+	uint16_t dl_words;
+	uint32_t img_offset;	// next free byte in the scratch half of this frame
+	uint32_t rec_start;	// RAM_DL offset the snippet being recorded starts at
+	snippet_t * recording;
+	snippet_t * replaying;	// draw calls are skipped while the snippet of an object stands in for them
+	dl_state_t state;
+	dl_state_t saved;
+} dl_frame_t;
+
+typedef struct {
+	const lv_font_t * font;
+	uint32_t addr;
+	uint8_t handle;
+	uint8_t firstchar;
+} font_map_t;
+
+// anti-aliased ROM fonts and their line height
+static const uint8_t rom_fonts[][2] = {
+	{26, 16}, {27, 20}, {28, 25}, {29, 28}, {30, 36}, {31, 49}
+};
+
+static dl_frame_t frame;
+static uint8_t scratch_half = 0;
+
+static font_map_t font_map[FONT_HANDLE_MAX - FONT_HANDLE_MIN + 1];
+static uint8_t font_cnt = 0;
+
+static snippet_t snippets[SNIPPETS_MAX];
+
+
+/* display-list building */
+
+static void state_invalidate(void)
+{
+	frame.prim = 0xff;
+	frame.state.color = 0xffffffffUL;
+	frame.state.opa = -1;
+	frame.state.line_width = 0xffff;
+	frame.state.clip.x1 = -1;
+}
+
+
+static void dl(uint32_t command)
+{
+	if(frame.overflow)
+	{
+		return;
+	}
+
+	if(frame.dl_words >= DL_WORDS_MAX)
+	{
+		frame.overflow = true;
+		ESP_LOGW(LOG_TAG, "display-list full, frame truncated");
+		return;
+	}
+
+	EVE_cmd_dl(command);
+	frame.dl_words++;
+}
+
+
+// account for a co-processor command that adds about "dl_cost" words to the display-list
+static bool cmd_reserve(uint16_t dl_cost)
+{
+	if(frame.overflow || (frame.dl_words + dl_cost) >= DL_WORDS_MAX)
+	{
+		frame.overflow = true;
+		return false;
+	}
+
+	frame.dl_words += dl_cost;
+	return true;
+}
+
+
+static void frame_begin(void)
+{
+	while(EVE_busy());	// the co-processor has to be done with the previous list
+
+	memset(&frame, 0, sizeof(frame));
+	frame.open = true;
+	state_invalidate();
+	FT81x_ramg_frame_begin();
+
+	EVE_start_cmd_burst();
+
+	dl(CMD_DLSTART);
+	dl(DL_CLEAR_RGB | 0x000000UL);
+	dl(CLEAR(1, 1, 1));
+	dl(VERTEX_FORMAT(1));
+
+	// bitmap handle setup is part of the display-list, so the font handles have to be set for every frame
+	for(uint8_t i = 0; i < font_cnt; i++)
+	{
+		if(cmd_reserve(8))
+		{
+			EVE_cmd_dl(CMD_SETFONT2);
+			EVE_cmd_dl(font_map[i].handle);
+			EVE_cmd_dl(font_map[i].addr);
+			EVE_cmd_dl(font_map[i].firstchar);
+		}
+	}
+}
+
+
+static void ctx_save(void)
+{
+	dl(SAVE_CONTEXT());
+	frame.saved = frame.state;
+}
+
+
+static void ctx_restore(void)
+{
+	dl(RESTORE_CONTEXT());
+	frame.state = frame.saved;
+	frame.prim = 0xff;	// co-processor commands inside the context may have started their own primitive
+}
+
+
+static void set_scissor(const lv_area_t * area)
+{
+	dl(SCISSOR_XY(area->x1, area->y1));
+	dl(SCISSOR_SIZE(lv_area_get_width(area), lv_area_get_height(area)));
+}
+
+
+static void set_clip(const lv_area_t * clip)
+{
+	if(clip->x1 == frame.state.clip.x1 && clip->y1 == frame.state.clip.y1 &&
+	   clip->x2 == frame.state.clip.x2 && clip->y2 == frame.state.clip.y2)
+	{
+		return;
+	}
+
+	set_scissor(clip);
+	lv_area_copy(&frame.state.clip, clip);
+}
+
+
+static void set_color(lv_color_t color, lv_opa_t opa)
+{
+	uint32_t rgb = lv_color_to32(color) & 0x00ffffffUL;
+
+	if(rgb != frame.state.color)
+	{
+		dl(DL_COLOR_RGB | rgb);
+		frame.state.color = rgb;
+	}
+
+	if(opa != frame.state.opa)
+	{
+		dl(COLOR_A(opa));
+		frame.state.opa = opa;
+	}
+}
+
+
+static void set_prim(uint8_t prim)
+{
+	if(prim != frame.prim)
+	{
+		dl(DL_BEGIN | prim);
+		frame.prim = prim;
+	}
+}
+
+
+// LINE_WIDTH is in 1/16 pixel and is the half width of lines and the corner radius of rects
+static void set_line_width(uint16_t width)
+{
+	if(width != frame.state.line_width)
+	{
+		dl(LINE_WIDTH(width));
+		frame.state.line_width = width;
+	}
+}
+
+
+// open the display-list if this is the first draw call of the frame and clip to the area LvGL is rendering
+static bool frame_prepare(const lv_area_t * clip)
+{
+	if(tft_active == 0)
+	{
+		return false;
+	}
+
+	if(!frame.open)
+	{
+		frame_begin();
+	}
+
+	if(frame.overflow || frame.replaying != NULL)
+	{
+		return false;
+	}
+
+	set_clip(clip);
+	return true;
+}
+
+
+static inline bool drawing_to_layer(lv_draw_ctx_t * draw_ctx)
+{
+	FT81x_draw_ctx_t * ctx = (FT81x_draw_ctx_t *) draw_ctx;
+
+	return (draw_ctx->buf != ctx->drv->draw_buf->buf_act);
+}
+
+
+/* primitives */
+
+static lv_coord_t clamp_radius(const lv_area_t * area, lv_coord_t radius)
+{
+	lv_coord_t short_side = LV_MIN(lv_area_get_width(area), lv_area_get_height(area));
+
+	if(radius > (short_side / 2))
+	{
+		radius = short_side / 2;
+	}
+
+	return LV_MIN(radius, 255);	// LINE_WIDTH limit
+}
+
+
+static void dl_rect(const lv_area_t * area, lv_coord_t radius)
+{
+	lv_coord_t w = lv_area_get_width(area);
+	lv_coord_t h = lv_area_get_height(area);
+
+	if(w <= 0 || h <= 0)
+	{
+		return;
+	}
+
+	radius = clamp_radius(area, radius);
+
+	if(w == h && (radius * 2) >= w)
+	{
+		set_prim(EVE_POINTS);
+		dl(POINT_SIZE(w * 8));
+		dl(VERTEX2F(area->x1 * 2 + w, area->y1 * 2 + h));
+		return;
+	}
+
+	// rects grow by the corner radius, a half pixel radius keeps the corners of square rects sharp
+	int32_t r2 = (radius > 0) ? (radius * 2) : 1;
+
+	set_prim(EVE_RECTS);
+	set_line_width(r2 * 8);
+	dl(VERTEX2F(area->x1 * 2 + r2, area->y1 * 2 + r2));
+	dl(VERTEX2F((area->x2 + 1) * 2 - r2, (area->y2 + 1) * 2 - r2));
+}
+
+
+static void stencil_clear(const lv_area_t * area)
+{
+	lv_area_t a;
+
+	if(_lv_area_intersect(&a, area, &frame.state.clip))
+	{
+		set_scissor(&a);
+		dl(CLEAR_STENCIL(0));
+		dl(CLEAR(0, 1, 0));
+	}
+}
+
+
+// fill "outer" except for "inner", used for borders and outlines
+static void dl_ring(const lv_area_t * outer, lv_coord_t r_out, const lv_area_t * inner, lv_coord_t r_in, lv_color_t color, lv_opa_t opa)
+{
+	if(inner->x2 < inner->x1 || inner->y2 < inner->y1)
+	{
+		set_color(color, opa);
+		dl_rect(outer, r_out);
+		return;
+	}
+
+	ctx_save();
+
+	dl(COLOR_MASK(0, 0, 0, 0));
+	dl(STENCIL_OP(EVE_KEEP, EVE_REPLACE));
+	dl(STENCIL_FUNC(EVE_ALWAYS, 1, 255));
+	dl_rect(inner, r_in);
+
+	dl(COLOR_MASK(1, 1, 1, 1));
+	dl(STENCIL_OP(EVE_KEEP, EVE_KEEP));
+	dl(STENCIL_FUNC(EVE_NOTEQUAL, 1, 255));
+	set_color(color, opa);
+	dl_rect(outer, r_out);
+
+	stencil_clear(inner);
+
+	ctx_restore();
+}
+
+
+/* rectangles */
+
+static void draw_shadow(const lv_draw_rect_dsc_t * dsc, const lv_area_t * coords)
+{
+	if(dsc->shadow_width <= 0 || dsc->shadow_opa <= LV_OPA_MIN)
+	{
+		return;
+	}
+
+	// no blur on EVE, stack a few growing rects with low opacity instead
+	lv_area_t core = *coords;
+	core.x1 += dsc->shadow_ofs_x - dsc->shadow_spread;
+	core.x2 += dsc->shadow_ofs_x + dsc->shadow_spread;
+	core.y1 += dsc->shadow_ofs_y - dsc->shadow_spread;
+	core.y2 += dsc->shadow_ofs_y + dsc->shadow_spread;
+
+	lv_coord_t radius = clamp_radius(coords, dsc->radius) + dsc->shadow_spread;
+	lv_opa_t opa = LV_MAX(dsc->shadow_opa / SHADOW_STEPS, 1);
+
+	set_color(dsc->shadow_color, opa);
+
+	for(int8_t i = SHADOW_STEPS; i > 0; i--)
+	{
+		lv_coord_t grow = (dsc->shadow_width / 2) * i / SHADOW_STEPS;
+		lv_area_t a = core;
+		a.x1 -= grow;
+		a.y1 -= grow;
+		a.x2 += grow;
+		a.y2 += grow;
+		dl_rect(&a, LV_MAX(radius, 0) + grow);
+	}
+}
+
+
+static void draw_gradient(const lv_draw_rect_dsc_t * dsc, const lv_area_t * coords)
+{
+	const lv_grad_dsc_t * grad = &dsc->bg_grad;
+	bool ver = (grad->dir == LV_GRAD_DIR_VER);
+	lv_coord_t len = ver ? lv_area_get_height(coords) : lv_area_get_width(coords);
+	lv_coord_t start = ver ? coords->y1 : coords->x1;
+	lv_coord_t radius = clamp_radius(coords, dsc->radius);
+	lv_area_t clip = frame.state.clip;
+
+	ctx_save();
+
+	// CMD_GRADIENT fills the whole scissor area, a stencil mask cuts out the rounded corners
+	if(radius > 0)
+	{
+		dl(COLOR_MASK(0, 0, 0, 0));
+		dl(STENCIL_OP(EVE_KEEP, EVE_REPLACE));
+		dl(STENCIL_FUNC(EVE_ALWAYS, 1, 255));
+		dl_rect(coords, radius);
+		dl(COLOR_MASK(1, 1, 1, 1));
+		dl(STENCIL_OP(EVE_KEEP, EVE_KEEP));
+		dl(STENCIL_FUNC(EVE_EQUAL, 1, 255));
+	}
+
+	for(uint8_t i = 0; (i + 1) < grad->stops_count; i++)
+	{
+		lv_coord_t p0 = start + (grad->stops[i].frac * (len - 1)) / 255;
+		lv_coord_t p1 = start + (grad->stops[i + 1].frac * (len - 1)) / 255;
+		lv_area_t band = *coords;
+		lv_area_t a;
+
+		// before the first and after the last stop the colors are clamped by CMD_GRADIENT
+		if(ver)
+		{
+			band.y1 = (i == 0) ? coords->y1 : p0;
+			band.y2 = ((i + 2) == grad->stops_count) ? coords->y2 : p1;
+		}
+		else
+		{
+			band.x1 = (i == 0) ? coords->x1 : p0;
+			band.x2 = ((i + 2) == grad->stops_count) ? coords->x2 : p1;
+		}
+
+		if(!_lv_area_intersect(&a, &band, &clip))
+		{
+			continue;
+		}
+
+		set_scissor(&a);
+
+		if(cmd_reserve(12))
+		{
+			uint32_t rgb0 = lv_color_to32(grad->stops[i].color);
+			uint32_t rgb1 = lv_color_to32(grad->stops[i + 1].color);
+
+			if(ver)
+			{
+				EVE_cmd_gradient(coords->x1, p0, rgb0, coords->x1, p1, rgb1);
+			}
+			else
+			{
+				EVE_cmd_gradient(p0, coords->y1, rgb0, p1, coords->y1, rgb1);
+			}
+		}
+	}
+
+	if(radius > 0)
+	{
+		stencil_clear(coords);
+	}
+
+	ctx_restore();
+}
+
+
+static void draw_bg(const lv_draw_rect_dsc_t * dsc, const lv_area_t * coords)
+{
+	if(dsc->bg_opa <= LV_OPA_MIN)
+	{
+		return;
+	}
+
+	lv_grad_dir_t grad_dir = dsc->bg_grad.dir;
+	lv_color_t bg_color = (grad_dir == LV_GRAD_DIR_NONE) ? dsc->bg_color : dsc->bg_grad.stops[0].color;
+
+	if(grad_dir != LV_GRAD_DIR_NONE && (dsc->bg_grad.stops_count < 2 || bg_color.full == dsc->bg_grad.stops[1].color.full))
+	{
+		grad_dir = LV_GRAD_DIR_NONE;
+	}
+
+	if(grad_dir == LV_GRAD_DIR_NONE)
+	{
+		set_color(bg_color, dsc->bg_opa);
+		dl_rect(coords, dsc->radius);
+	}
+	else
+	{
+		draw_gradient(dsc, coords);
+	}
+}
+
+
+static void draw_bg_img(lv_draw_ctx_t * draw_ctx, const lv_draw_rect_dsc_t * dsc, const lv_area_t * coords)
+{
+	if(dsc->bg_img_src == NULL || dsc->bg_img_opa <= LV_OPA_MIN)
+	{
+		return;
+	}
+
+	if(lv_img_src_get_type(dsc->bg_img_src) == LV_IMG_SRC_SYMBOL)
+	{
+		lv_point_t size;
+		lv_txt_get_size(&size, dsc->bg_img_src, dsc->bg_img_symbol_font, 0, 0, LV_COORD_MAX, LV_TEXT_FLAG_NONE);
+
+		lv_area_t a;
+		a.x1 = coords->x1 + lv_area_get_width(coords) / 2 - size.x / 2;
+		a.x2 = a.x1 + size.x - 1;
+		a.y1 = coords->y1 + lv_area_get_height(coords) / 2 - size.y / 2;
+		a.y2 = a.y1 + size.y - 1;
+
+		lv_draw_label_dsc_t label_dsc;
+		lv_draw_label_dsc_init(&label_dsc);
+		label_dsc.font = dsc->bg_img_symbol_font;
+		label_dsc.color = dsc->bg_img_recolor;
+		label_dsc.opa = dsc->bg_img_opa;
+		lv_draw_label(draw_ctx, &label_dsc, &a, dsc->bg_img_src, NULL);
+		return;
+	}
+
+	lv_img_header_t header;
+	if(lv_img_decoder_get_info(dsc->bg_img_src, &header) != LV_RES_OK)
+	{
+		return;
+	}
+
+	lv_draw_img_dsc_t img_dsc;
+	lv_draw_img_dsc_init(&img_dsc);
+	img_dsc.recolor = dsc->bg_img_recolor;
+	img_dsc.recolor_opa = dsc->bg_img_recolor_opa;
+	img_dsc.opa = dsc->bg_img_opa;
+
+	lv_area_t a;
+	if(!dsc->bg_img_tiled)
+	{
+		a.x1 = coords->x1 + lv_area_get_width(coords) / 2 - header.w / 2;
+		a.y1 = coords->y1 + lv_area_get_height(coords) / 2 - header.h / 2;
+		a.x2 = a.x1 + header.w - 1;
+		a.y2 = a.y1 + header.h - 1;
+		lv_draw_img(draw_ctx, &img_dsc, &a, dsc->bg_img_src);
+		return;
+	}
+
+	for(a.y1 = coords->y1; a.y1 <= coords->y2; a.y1 += header.h)
+	{
+		a.y2 = a.y1 + header.h - 1;
+		for(a.x1 = coords->x1; a.x1 <= coords->x2; a.x1 += header.w)
+		{
+			a.x2 = a.x1 + header.w - 1;
+			lv_draw_img(draw_ctx, &img_dsc, &a, dsc->bg_img_src);
+		}
+	}
+}
+
+
+static void draw_border(const lv_draw_rect_dsc_t * dsc, const lv_area_t * coords)
+{
+	if(dsc->border_opa <= LV_OPA_MIN || dsc->border_width <= 0 || dsc->border_side == LV_BORDER_SIDE_NONE)
+	{
+		return;
+	}
+
+	lv_coord_t bw = dsc->border_width;
+
+	if((dsc->border_side & LV_BORDER_SIDE_FULL) != LV_BORDER_SIDE_FULL)
+	{
+		// single sides are drawn as plain rects, the corners are not rounded
+		lv_area_t a;
+		lv_coord_t y1 = coords->y1;
+		lv_coord_t y2 = coords->y2;
+
+		set_color(dsc->border_color, dsc->border_opa);
+
+		if(dsc->border_side & LV_BORDER_SIDE_TOP)
+		{
+			lv_area_set(&a, coords->x1, coords->y1, coords->x2, coords->y1 + bw - 1);
+			dl_rect(&a, 0);
+			y1 += bw;
+		}
+		if(dsc->border_side & LV_BORDER_SIDE_BOTTOM)
+		{
+			lv_area_set(&a, coords->x1, coords->y2 - bw + 1, coords->x2, coords->y2);
+			dl_rect(&a, 0);
+			y2 -= bw;
+		}
+		if(dsc->border_side & LV_BORDER_SIDE_LEFT)
+		{
+			lv_area_set(&a, coords->x1, y1, coords->x1 + bw - 1, y2);
+			dl_rect(&a, 0);
+		}
+		if(dsc->border_side & LV_BORDER_SIDE_RIGHT)
+		{
+			lv_area_set(&a, coords->x2 - bw + 1, y1, coords->x2, y2);
+			dl_rect(&a, 0);
+		}
+		return;
+	}
+
+	lv_coord_t radius = clamp_radius(coords, dsc->radius);
+	lv_area_t inner = *coords;
+	inner.x1 += bw;
+	inner.y1 += bw;
+	inner.x2 -= bw;
+	inner.y2 -= bw;
+
+	dl_ring(coords, radius, &inner, LV_MAX(radius - bw, 0), dsc->border_color, dsc->border_opa);
+}
+
+
+static void draw_outline(const lv_draw_rect_dsc_t * dsc, const lv_area_t * coords)
+{
+	if(dsc->outline_opa <= LV_OPA_MIN || dsc->outline_width <= 0)
+	{
+		return;
+	}
+
+	lv_coord_t pad = dsc->outline_pad;
+	lv_coord_t ow = dsc->outline_width;
+	lv_coord_t radius = clamp_radius(coords, dsc->radius);
+
+	lv_area_t inner = *coords;
+	inner.x1 -= pad;
+	inner.y1 -= pad;
+	inner.x2 += pad;
+	inner.y2 += pad;
+
+	lv_area_t outer = inner;
+	outer.x1 -= ow;
+	outer.y1 -= ow;
+	outer.x2 += ow;
+	outer.y2 += ow;
+
+	lv_coord_t r_in = (radius > 0) ? (radius + pad) : 0;
+	lv_coord_t r_out = (radius > 0) ? (r_in + ow) : 0;
+
+	dl_ring(&outer, r_out, &inner, r_in, dsc->outline_color, dsc->outline_opa);
+}
+
+
+static void draw_rect_cb(lv_draw_ctx_t * draw_ctx, const lv_draw_rect_dsc_t * dsc, const lv_area_t * coords)
+{
+	FT81x_draw_ctx_t * ctx = (FT81x_draw_ctx_t *) draw_ctx;
+
+	if(drawing_to_layer(draw_ctx))
+	{
+		ctx->sw_draw_rect(draw_ctx, dsc, coords);
+		return;
+	}
+
+	if(!frame_prepare(draw_ctx->clip_area))
+	{
+		return;
+	}
+
+	draw_shadow(dsc, coords);
+	draw_bg(dsc, coords);
+	draw_bg_img(draw_ctx, dsc, coords);
+	draw_border(dsc, coords);
+	draw_outline(dsc, coords);
+}
+
+
+static void draw_bg_cb(lv_draw_ctx_t * draw_ctx, const lv_draw_rect_dsc_t * dsc, const lv_area_t * coords)
+{
+	FT81x_draw_ctx_t * ctx = (FT81x_draw_ctx_t *) draw_ctx;
+
+	if(drawing_to_layer(draw_ctx))
+	{
+		ctx->sw_draw_bg(draw_ctx, dsc, coords);
+		return;
+	}
+
+	if(!frame_prepare(draw_ctx->clip_area))
+	{
+		return;
+	}
+
+	draw_bg(dsc, coords);
+	draw_bg_img(draw_ctx, dsc, coords);
+}
+
+
+/* lines, arcs and polygons */
+
+static void draw_line_cb(lv_draw_ctx_t * draw_ctx, const lv_draw_line_dsc_t * dsc, const lv_point_t * point1, const lv_point_t * point2)
+{
+	FT81x_draw_ctx_t * ctx = (FT81x_draw_ctx_t *) draw_ctx;
+
+	if(drawing_to_layer(draw_ctx))
+	{
+		ctx->sw_draw_line(draw_ctx, dsc, point1, point2);
+		return;
+	}
+
+	if(dsc->width == 0 || dsc->opa <= LV_OPA_MIN || (point1->x == point2->x && point1->y == point2->y))
+	{
+		return;
+	}
+
+	if(!frame_prepare(draw_ctx->clip_area))
+	{
+		return;
+	}
+
+	set_color(dsc->color, dsc->opa);
+
+	// use LvGL's geometry for horizontal and vertical lines, these are the only ones with dashes
+	if(point1->x == point2->x || point1->y == point2->y)
+	{
+		bool hor = (point1->y == point2->y);
+		lv_coord_t w_half0 = (dsc->width - 1) >> 1;
+		lv_coord_t w_half1 = w_half0 + ((dsc->width - 1) & 1);
+		lv_coord_t start = hor ? LV_MIN(point1->x, point2->x) : LV_MIN(point1->y, point2->y);
+		lv_coord_t end = (hor ? LV_MAX(point1->x, point2->x) : LV_MAX(point1->y, point2->y)) - 1;
+		lv_coord_t dash = (dsc->dash_width && dsc->dash_gap) ? dsc->dash_width : (end - start + 1);
+		lv_coord_t gap = (dsc->dash_width && dsc->dash_gap) ? dsc->dash_gap : 0;
+		lv_area_t a;
+
+		for(lv_coord_t pos = start; pos <= end; pos += dash + gap)
+		{
+			lv_coord_t pos_end = LV_MIN(pos + dash - 1, end);
+
+			if(hor)
+			{
+				lv_area_set(&a, pos, point1->y - w_half1, pos_end, point1->y + w_half0);
+			}
+			else
+			{
+				lv_area_set(&a, point1->x - w_half1, pos, point1->x + w_half0, pos_end);
+			}
+			dl_rect(&a, 0);
+		}
+		return;
+	}
+
+	// EVE lines always have round caps, LINE_WIDTH is the half width
+	set_prim(EVE_LINES);
+	set_line_width(dsc->width * 8);
+	dl(VERTEX2F(point1->x * 2 + 1, point1->y * 2 + 1));
+	dl(VERTEX2F(point2->x * 2 + 1, point2->y * 2 + 1));
+}
+
+
+static void draw_arc_cb(lv_draw_ctx_t * draw_ctx, const lv_draw_arc_dsc_t * dsc, const lv_point_t * center, uint16_t radius, uint16_t start_angle, uint16_t end_angle)
+{
+	FT81x_draw_ctx_t * ctx = (FT81x_draw_ctx_t *) draw_ctx;
+
+	if(drawing_to_layer(draw_ctx))
+	{
+		ctx->sw_draw_arc(draw_ctx, dsc, center, radius, start_angle, end_angle);
+		return;
+	}
+
+	if(dsc->opa <= LV_OPA_MIN || dsc->width == 0 || radius == 0 || start_angle == end_angle)
+	{
+		return;
+	}
+
+	if(!frame_prepare(draw_ctx->clip_area))
+	{
+		return;
+	}
+
+	lv_coord_t width = LV_MIN(dsc->width, (lv_coord_t)radius);
+	int32_t r_mid2 = radius * 2 - width;	// radius of the center of the stroke in 1/2 pixel
+	int32_t start = start_angle % 360;
+	int32_t span = (int32_t)end_angle - start_angle;
+
+	while(span < 0)
+	{
+		span += 360;
+	}
+	if(span > 360)
+	{
+		span = 360;
+	}
+
+	// line strips have round caps, pull square ends in by the cap size
+	if(!dsc->rounded && span < 360 && r_mid2 > 0)
+	{
+		int32_t cap = (width * 573) / (r_mid2 * 10);
+		if((cap * 2) >= span)
+		{
+			return;
+		}
+		start += cap;
+		span -= cap * 2;
+	}
+
+	int32_t step = (radius < 20) ? 15 : ((radius < 80) ? 8 : 4);
+	int32_t n = (span + step - 1) / step;
+
+	set_color(dsc->color, dsc->opa);
+	set_line_width(width * 8);
+
+	// a new BEGIN for every strip, otherwise it would be connected to the previous one
+	dl(DL_BEGIN | EVE_LINE_STRIP);
+	frame.prim = EVE_LINE_STRIP;
+
+	for(int32_t i = 0; i <= n; i++)
+	{
+		int16_t angle = (int16_t)(start + ((i == n) ? span : (i * step)));
+		int32_t x = center->x * 2 + 1 + ((lv_trigo_cos(angle) * r_mid2) >> LV_TRIGO_SHIFT);
+		int32_t y = center->y * 2 + 1 + ((lv_trigo_sin(angle) * r_mid2) >> LV_TRIGO_SHIFT);
+		dl(VERTEX2F(x, y));
+	}
+}
+
+
+static void draw_polygon_cb(lv_draw_ctx_t * draw_ctx, const lv_draw_rect_dsc_t * dsc, const lv_point_t * points, uint16_t point_cnt)
+{
+	FT81x_draw_ctx_t * ctx = (FT81x_draw_ctx_t *) draw_ctx;
+
+	if(drawing_to_layer(draw_ctx))
+	{
+		ctx->sw_draw_polygon(draw_ctx, dsc, points, point_cnt);
+		return;
+	}
+
+	if(point_cnt < 3 || dsc->bg_opa <= LV_OPA_MIN)
+	{
+		return;
+	}
+
+	lv_area_t bbox = {points[0].x, points[0].y, points[0].x, points[0].y};
+	for(uint16_t i = 1; i < point_cnt; i++)
+	{
+		bbox.x1 = LV_MIN(bbox.x1, points[i].x);
+		bbox.y1 = LV_MIN(bbox.y1, points[i].y);
+		bbox.x2 = LV_MAX(bbox.x2, points[i].x);
+		bbox.y2 = LV_MAX(bbox.y2, points[i].y);
+	}
+
+	lv_area_t a;
+	if(!_lv_area_intersect(&a, &bbox, draw_ctx->clip_area))
+	{
+		return;
+	}
+
+	if(!frame_prepare(draw_ctx->clip_area))
+	{
+		return;
+	}
+
+	ctx_save();
+
+	// every edge inverts the stencil below it, pixels inside the polygon end up being inverted an odd number of times
+	set_scissor(&a);
+	dl(COLOR_MASK(0, 0, 0, 0));
+	dl(STENCIL_OP(EVE_INVERT, EVE_INVERT));
+	dl(STENCIL_FUNC(EVE_ALWAYS, 255, 255));
+	dl(DL_BEGIN | EVE_EDGE_STRIP_B);
+	frame.prim = EVE_EDGE_STRIP_B;
+	for(uint16_t i = 0; i <= point_cnt; i++)
+	{
+		const lv_point_t * p = &points[i % point_cnt];
+		dl(VTX(p->x, p->y));
+	}
+
+	dl(COLOR_MASK(1, 1, 1, 1));
+	dl(STENCIL_OP(EVE_KEEP, EVE_KEEP));
+	dl(STENCIL_FUNC(EVE_EQUAL, 255, 255));
+	set_color(dsc->bg_color, dsc->bg_opa);
+	dl_rect(&bbox, 0);
+
+	dl(CLEAR_STENCIL(0));
+	dl(CLEAR(0, 1, 0));
+
+	ctx_restore();
+}
+
+
+/* text */
+
+static const font_map_t * font_find(const lv_font_t * font)
+{
+	for(uint8_t i = 0; i < font_cnt; i++)
+	{
+		if(font_map[i].font == font)
+		{
+			return &font_map[i];
+		}
+	}
+	return NULL;
+}
+
+
+static uint8_t rom_font_for(const lv_font_t * font)
+{
+	uint8_t handle = rom_fonts[0][0];
+
+	for(uint8_t i = 0; i < sizeof(rom_fonts) / sizeof(rom_fonts[0]); i++)
+	{
+		if(rom_fonts[i][1] <= font->line_height)
+		{
+			handle = rom_fonts[i][0];
+		}
+	}
+	return handle;
+}
+
+
+static void draw_letter_cb(lv_draw_ctx_t * draw_ctx, const lv_draw_label_dsc_t * dsc, const lv_point_t * pos_p, uint32_t letter)
+{
+	FT81x_draw_ctx_t * ctx = (FT81x_draw_ctx_t *) draw_ctx;
+
+	if(drawing_to_layer(draw_ctx))
+	{
+		ctx->sw_draw_letter(draw_ctx, dsc, pos_p, letter);
+		return;
+	}
+
+	// legacy EVE fonts have up to 128 cells, the cell is the character code
+	if(dsc->opa <= LV_OPA_MIN || letter <= ' ' || letter >= EVE_NUMCHAR_PERFONT)
+	{
+		return;
+	}
+
+	const font_map_t * map = font_find(dsc->font);
+	uint8_t handle;
+
+	if(map != NULL)
+	{
+		if(letter < map->firstchar)
+		{
+			return;
+		}
+		handle = map->handle;
+	}
+	else
+	{
+		handle = rom_font_for(dsc->font);
+	}
+
+	if(!frame_prepare(draw_ctx->clip_area))
+	{
+		return;
+	}
+
+	set_color(dsc->color, dsc->opa);
+	set_prim(EVE_BITMAPS);
+
+	if(pos_p->x >= 0 && pos_p->x < 512 && pos_p->y >= 0 && pos_p->y < 512)
+	{
+		dl(VERTEX2II(pos_p->x, pos_p->y, handle, letter));
+	}
+	else
+	{
+		dl(BITMAP_HANDLE(handle));
+		dl(CELL(letter));
+		dl(VTX(pos_p->x, pos_p->y));
+	}
+}
+
+
+/* images */
+
+static inline uint16_t px_get(const uint8_t * p)
+{
+#if LV_COLOR_16_SWAP
+	return (uint16_t)((p[0] << 8) | p[1]);
+#else
+	return (uint16_t)(p[0] | (p[1] << 8));
+#endif
+}
+
+
+static inline uint16_t px_argb4(uint16_t c, uint8_t a)
+{
+	return (uint16_t)(((a >> 4) << 12) | ((c >> 12) << 8) | (((c >> 7) & 0x0f) << 4) | ((c >> 1) & 0x0f));
+}
+
+
+// convert "rows" rows starting at "row" into the bounce buffer, returns the number of bytes
+static uint32_t img_convert(uint8_t * out, const uint8_t * map_p, lv_img_cf_t cf, lv_coord_t w, lv_coord_t h, lv_coord_t row, lv_coord_t rows)
+{
+	uint32_t px_first = (uint32_t)row * w;
+	uint32_t px_cnt = (uint32_t)rows * w;
+	uint16_t * out16 = (uint16_t *) out;
+	uint16_t chroma = LV_COLOR_CHROMA_KEY.full;
+
+	switch(cf)
+	{
+		case LV_IMG_CF_TRUE_COLOR:
+			for(uint32_t i = 0; i < px_cnt; i++)
+			{
+				out16[i] = px_get(&map_p[(px_first + i) * 2]);
+			}
+			return px_cnt * 2;
+
+		case LV_IMG_CF_TRUE_COLOR_CHROMA_KEYED:
+			for(uint32_t i = 0; i < px_cnt; i++)
+			{
+				uint16_t c = px_get(&map_p[(px_first + i) * 2]);
+				out16[i] = (c == chroma) ? 0 : (uint16_t)(0x8000 | ((c >> 11) << 10) | (((c >> 6) & 0x1f) << 5) | (c & 0x1f));
+			}
+			return px_cnt * 2;
+
+		case LV_IMG_CF_TRUE_COLOR_ALPHA:
+			for(uint32_t i = 0; i < px_cnt; i++)
+			{
+				const uint8_t * p = &map_p[(px_first + i) * 3];
+				out16[i] = px_argb4(px_get(p), p[2]);
+			}
+			return px_cnt * 2;
+
+		case LV_IMG_CF_RGB565A8:
+			for(uint32_t i = 0; i < px_cnt; i++)
+			{
+				out16[i] = px_argb4(px_get(&map_p[(px_first + i) * 2]), map_p[(uint32_t)w * h * 2 + px_first + i]);
+			}
+			return px_cnt * 2;
+
+		case LV_IMG_CF_ALPHA_8BIT:
+			memcpy(out, &map_p[px_first], px_cnt);
+			return px_cnt;
+
+		default:
+			return 0;
+	}
+}
+
+
+// wait until the list from two frames ago is off the screen, its scratch half and idle cache entries can be overwritten then
+static void img_wait_swap(void)
+{
+	if(!frame.swap_done)
+	{
+		EVE_cmd_execute();
+		while(EVE_memRead8(REG_DLSWAP) != EVE_DLSWAP_DONE);
+		frame.swap_done = true;
+	}
+}
+
+
+/* images in flash can not change, these are kept in the RAM_G cache and only sent once */
+/* everything else is copied to the scratch half of this frame for every frame it is drawn in */
+static bool img_upload(const uint8_t * map_p, lv_img_cf_t cf, lv_coord_t w, lv_coord_t h, uint8_t bpp, uint32_t * addr)
+{
+	uint32_t size = (uint32_t)w * h * bpp;
+	uint32_t size_aligned = (size + 3) & ~3UL;
+	uint8_t * bounce = FT81x_ramg_bounce();
+	lv_coord_t chunk_rows = FT81X_RAMG_BOUNCE_SIZE / (w * bpp);
+
+	if(FT81x_ramg_find(map_p, size, addr))
+	{
+		return true;
+	}
+
+	if(bounce == NULL || chunk_rows == 0)
+	{
+		return false;
+	}
+
+	// this has to leave the cmd-burst as it writes to RAM_G directly
+	EVE_end_cmd_burst();
+	img_wait_swap();
+
+	*addr = FT81X_RAMG_NONE;
+	if(esp_ptr_in_drom(map_p))
+	{
+		*addr = FT81x_ramg_cache_alloc(map_p, size);
+	}
+
+	if(*addr == FT81X_RAMG_NONE)
+	{
+		if((frame.img_offset + size_aligned) > SCRATCH_HALF)
+		{
+			ESP_LOGW(LOG_TAG, "image scratch full, increase CONFIG_LV_FT81X_DL_SCRATCH_KB");
+			EVE_start_cmd_burst();
+			return false;
+		}
+
+		*addr = FT81X_RAMG_SCRATCH_ADDR + (scratch_half * SCRATCH_HALF) + frame.img_offset;
+		frame.img_offset += size_aligned;
+	}
+
+	if(cf == LV_IMG_CF_TRUE_COLOR && !LV_COLOR_16_SWAP)
+	{
+		FT81x_ramg_write(*addr, map_p, size);	// LvGL may release the pixels as soon as we return
+	}
+	else
+	{
+		uint32_t dest = *addr;
+		for(lv_coord_t row = 0; row < h; row += chunk_rows)
+		{
+			uint32_t len = img_convert(bounce, map_p, cf, w, h, row, LV_MIN(chunk_rows, h - row));
+			FT81x_ramg_write(dest, bounce, len);
+			dest += len;
+		}
+	}
+
+	EVE_start_cmd_burst();
+	return true;
+}
+
+
+static void draw_img_decoded_cb(lv_draw_ctx_t * draw_ctx, const lv_draw_img_dsc_t * dsc, const lv_area_t * coords, const uint8_t * map_p, lv_img_cf_t cf)
+{
+	FT81x_draw_ctx_t * ctx = (FT81x_draw_ctx_t *) draw_ctx;
+	const FT81x_flash_asset_t * asset = NULL;
+
+#if defined (CONFIG_LV_FT81X_FLASH_ASSETS)
+	asset = FT81x_flash_asset_of(map_p);	// LvGL hands these over as true color
+#endif
+
+	if(drawing_to_layer(draw_ctx))
+	{
+		if(asset != NULL)
+		{
+			ESP_LOGW(LOG_TAG, "flash image %s can not be drawn into a layer", asset->name);
+			return;
+		}
+		ctx->sw_draw_img_decoded(draw_ctx, dsc, coords, map_p, cf);
+		return;
+	}
+
+	if(dsc->opa <= LV_OPA_MIN)
+	{
+		return;
+	}
+
+	uint16_t fmt;
+	uint8_t bpp = 2;
+
+	if(asset != NULL)
+	{
+		fmt = asset->format;
+	}
+	else switch(cf)
+	{
+		case LV_IMG_CF_TRUE_COLOR:
+			fmt = EVE_RGB565;
+			break;
+		case LV_IMG_CF_TRUE_COLOR_CHROMA_KEYED:
+			fmt = EVE_ARGB1555;
+			break;
+		case LV_IMG_CF_TRUE_COLOR_ALPHA:
+		case LV_IMG_CF_RGB565A8:
+			fmt = EVE_ARGB4;
+			break;
+		case LV_IMG_CF_ALPHA_8BIT:
+			fmt = EVE_L8;
+			bpp = 1;
+			break;
+		default:
+			ESP_LOGW(LOG_TAG, "image color format %d not supported", cf);
+			return;
+	}
+
+	lv_coord_t w = lv_area_get_width(coords);
+	lv_coord_t h = lv_area_get_height(coords);
+	bool transformed = (dsc->angle != 0 || dsc->zoom != LV_IMG_ZOOM_NONE);
+	lv_area_t area = *coords;
+
+	if(transformed)
+	{
+		_lv_img_buf_get_transformed_area(&area, w, h, dsc->angle, dsc->zoom, &dsc->pivot);
+		area.x1 += coords->x1;
+		area.y1 += coords->y1;
+		area.x2 += coords->x1;
+		area.y2 += coords->y1;
+	}
+
+	lv_area_t visible;
+	if(!_lv_area_intersect(&visible, &area, draw_ctx->clip_area))
+	{
+		return;
+	}
+
+	if(!frame_prepare(draw_ctx->clip_area))
+	{
+		return;
+	}
+
+	uint32_t addr;
+	if(asset != NULL)
+	{
+		addr = FT81X_FLASH_BITMAP_ADDR(asset->addr);	// ASTC is rendered straight from flash
+	}
+	else if(!img_upload(map_p, cf, w, h, bpp, &addr))
+	{
+		return;
+	}
+
+	// scratch and cache entries are overwritten or moved later on, the snippet would show stale pixels
+	if(frame.recording != NULL && asset == NULL && !FT81x_ramg_is_fixed(addr))
+	{
+		frame.rec_volatile = true;
+	}
+
+	if(transformed)
+	{
+		ctx_save();
+	}
+
+	// L8 is drawn with COLOR_RGB as tint, alpha only images are drawn in the recolor color by LvGL as well
+	set_color((cf == LV_IMG_CF_ALPHA_8BIT) ? dsc->recolor : lv_color_white(), dsc->opa);
+
+	dl(BITMAP_HANDLE(IMG_HANDLE));
+	if(cmd_reserve(6))
+	{
+		EVE_cmd_setbitmap(addr, fmt, w, h);
+	}
+
+	if(transformed)
+	{
+		lv_coord_t aw = lv_area_get_width(&area);
+		lv_coord_t ah = lv_area_get_height(&area);
+
+		dl(BITMAP_SIZE(dsc->antialias ? EVE_BILINEAR : EVE_NEAREST, EVE_BORDER, EVE_BORDER, aw, ah));
+		dl(BITMAP_SIZE_H(aw, ah));
+
+		// the matrix maps the image around its pivot into the bounding box that is drawn at "area"
+		if(cmd_reserve(6))
+		{
+			EVE_cmd_dl(CMD_LOADIDENTITY);
+			EVE_cmd_translate(F16(coords->x1 + dsc->pivot.x - area.x1), F16(coords->y1 + dsc->pivot.y - area.y1));
+			if(dsc->zoom != LV_IMG_ZOOM_NONE)
+			{
+				EVE_cmd_scale(dsc->zoom * 256L, dsc->zoom * 256L);
+			}
+			if(dsc->angle != 0)
+			{
+				EVE_cmd_rotate((dsc->angle * 65536L) / 3600);
+			}
+			EVE_cmd_translate(F16(-dsc->pivot.x), F16(-dsc->pivot.y));
+			EVE_cmd_dl(CMD_SETMATRIX);
+		}
+	}
+
+	set_prim(EVE_BITMAPS);
+	dl(VTX(area.x1, area.y1));
+
+	if(transformed)
+	{
+		ctx_restore();
+	}
+}
+
+
+/* display-list snippets */
+
+// let the co-processor catch up with the burst and return how far it got with the display-list
+static uint32_t dl_offset_sync(void)
+{
+	EVE_end_cmd_burst();
+	EVE_cmd_execute();
+	uint32_t offset = EVE_memRead32(REG_CMD_DL);
+	EVE_start_cmd_burst();
+	return offset;
+}
+
+
+static snippet_t * snippet_find(const lv_obj_t * obj)
+{
+	for(uint8_t i = 0; i < SNIPPETS_MAX; i++)
+	{
+		if(snippets[i].obj == obj)
+		{
+			return &snippets[i];
+		}
+	}
+	return NULL;
+}
+
+
+static void snippet_drop(snippet_t * snip)
+{
+	if(snip->len)
+	{
+		FT81x_ramg_free(snip->addr);	// CMD_APPEND copies at build time, no list on screen refers to it
+		snip->len = 0;
+	}
+}
+
+
+static void snippet_record_begin(snippet_t * snip)
+{
+	snippet_drop(snip);
+
+	frame.rec_start = dl_offset_sync();
+	frame.rec_volatile = false;
+	frame.recording = snip;
+	state_invalidate();	// the snippet must not rely on state set up before it
+}
+
+
+static void snippet_record_end(snippet_t * snip)
+{
+	frame.recording = NULL;
+	snip->state = SNIPPET_FAILED;
+
+	uint32_t len = dl_offset_sync() - frame.rec_start;
+	if(frame.overflow || frame.rec_volatile || len == 0)
+	{
+		return;
+	}
+
+	uint32_t addr = FT81x_ramg_alloc(snip, len);
+	if(addr == FT81X_RAMG_NONE)
+	{
+		return;
+	}
+
+	EVE_cmd_dl(CMD_MEMCPY);
+	EVE_cmd_dl(addr);
+	EVE_cmd_dl(EVE_RAM_DL + frame.rec_start);
+	EVE_cmd_dl(len);
+
+	snip->addr = addr;
+	snip->len = len;
+	snip->state = SNIPPET_RECORDED;
+	state_invalidate();
+}
+
+
+static void snippet_replay(snippet_t * snip)
+{
+	if(cmd_reserve(snip->len / 4))
+	{
+		EVE_cmd_append(snip->addr, snip->len);
+		frame.replaying = snip;
+		state_invalidate();
+	}
+}
+
+
+static void snippet_event_cb(lv_event_t * e)
+{
+	lv_obj_t * obj = lv_event_get_target(e);
+	snippet_t * snip = snippet_find(obj);
+
+	if(snip == NULL)
+	{
+		return;
+	}
+
+	switch(lv_event_get_code(e))
+	{
+		case LV_EVENT_DRAW_MAIN_BEGIN:
+		{
+			lv_draw_ctx_t * draw_ctx = lv_event_get_draw_ctx(e);
+
+			if(frame.recording != NULL || frame.replaying != NULL || drawing_to_layer(draw_ctx) ||
+			   !frame_prepare(draw_ctx->clip_area))
+			{
+				break;
+			}
+
+			// the whole screen is drawn in one pass (see FT81x_draw_snippet_attach), so this runs once per frame
+			lv_area_copy(&snip->area, draw_ctx->clip_area);
+
+			if(!_lv_area_is_equal(&snip->coords, &obj->coords))
+			{
+				snippet_drop(snip);
+				lv_area_copy(&snip->coords, &obj->coords);
+				snip->state = SNIPPET_CHANGED;
+			}
+
+			if(snip->state == SNIPPET_RECORDED)
+			{
+				snippet_replay(snip);
+			}
+			else if(snip->state == SNIPPET_SETTLED)
+			{
+				snippet_record_begin(snip);
+			}
+			else if(snip->state == SNIPPET_CHANGED)
+			{
+				snip->state = SNIPPET_SETTLED;	// draw normally, things that change every frame are not worth a recording
+			}
+			break;
+		}
+
+		case LV_EVENT_DRAW_POST_END:
+			if(frame.replaying == snip)
+			{
+				frame.replaying = NULL;
+			}
+			else if(frame.recording == snip)
+			{
+				snippet_record_end(snip);
+			}
+			break;
+
+		// changes of the object itself, redraws of its children are caught by snippet_invalidate_area()
+		case LV_EVENT_STYLE_CHANGED:
+		case LV_EVENT_SIZE_CHANGED:
+		case LV_EVENT_CHILD_CHANGED:
+		case LV_EVENT_VALUE_CHANGED:
+		case LV_EVENT_SCROLL:
+		case LV_EVENT_REFRESH:
+			snip->state = SNIPPET_CHANGED;
+			break;
+
+		case LV_EVENT_DELETE:
+			snippet_drop(snip);
+			snip->obj = NULL;
+			break;
+
+		default:
+			break;
+	}
+}
+
+
+// drop the recordings that an invalidated area overlaps, whether a child, the object or something on top of it changed
+static void snippet_invalidate_area(const lv_area_t * area)
+{
+	for(uint8_t i = 0; i < SNIPPETS_MAX; i++)
+	{
+		if(snippets[i].obj != NULL && _lv_area_is_on(area, &snippets[i].area))
+		{
+			snippets[i].state = SNIPPET_CHANGED;
+		}
+	}
+}
+
+
+/* public functions */
+
+void FT81x_draw_ctx_init(lv_disp_drv_t * drv, lv_draw_ctx_t * draw_ctx)
+{
+	FT81x_draw_ctx_t * ctx = (FT81x_draw_ctx_t *) draw_ctx;
+
+	lv_draw_sw_init_ctx(drv, draw_ctx);
+
+	ctx->drv = drv;
+	ctx->sw_draw_rect = draw_ctx->draw_rect;
+	ctx->sw_draw_bg = draw_ctx->draw_bg;
+	ctx->sw_draw_arc = draw_ctx->draw_arc;
+	ctx->sw_draw_img_decoded = draw_ctx->draw_img_decoded;
+	ctx->sw_draw_letter = draw_ctx->draw_letter;
+	ctx->sw_draw_line = draw_ctx->draw_line;
+	ctx->sw_draw_polygon = draw_ctx->draw_polygon;
+
+	draw_ctx->draw_rect = draw_rect_cb;
+	draw_ctx->draw_bg = draw_bg_cb;
+	draw_ctx->draw_arc = draw_arc_cb;
+	draw_ctx->draw_img_decoded = draw_img_decoded_cb;
+	draw_ctx->draw_letter = draw_letter_cb;
+	draw_ctx->draw_line = draw_line_cb;
+	draw_ctx->draw_polygon = draw_polygon_cb;
+
+	FT81x_ramg_bounce();	// allocate the bounce buffer early while there still is DMA capable memory
+}
+
+
+void FT81x_draw_ctx_deinit(lv_disp_drv_t * drv, lv_draw_ctx_t * draw_ctx)
+{
+	lv_draw_sw_deinit_ctx(drv, draw_ctx);
+}
+
+
+void FT81x_draw_init_drv(lv_disp_drv_t * drv)
+{
+	drv->draw_ctx_init = FT81x_draw_ctx_init;
+	drv->draw_ctx_deinit = FT81x_draw_ctx_deinit;
+	drv->draw_ctx_size = sizeof(FT81x_draw_ctx_t);
+	drv->rounder_cb = FT81x_draw_rounder;
+}
+
+
+void FT81x_draw_rounder(lv_disp_drv_t * drv, lv_area_t * area)
+{
+	// LvGL passes every invalidated area through here before it is joined
+	snippet_invalidate_area(area);
+
+	area->x1 = 0;
+	area->y1 = 0;
+	area->x2 = drv->hor_res - 1;
+	area->y2 = drv->ver_res - 1;
+}
+
+
+void FT81x_draw_frame_end(void)
+{
+	if(tft_active == 0)
+	{
+		return;
+	}
+
+	if(!frame.open)
+	{
+		frame_begin();	// nothing was drawn, still show the cleared screen
+	}
+
+	EVE_cmd_dl(DL_DISPLAY);
+	EVE_cmd_dl(CMD_SWAP);
+
+	EVE_end_cmd_burst();
+	EVE_cmd_start();
+
+	frame.open = false;
+	scratch_half ^= 1;
+}
+
+
+bool FT81x_draw_add_font(const lv_font_t * font, uint8_t handle, uint32_t addr, uint8_t firstchar)
+{
+	if(font == NULL || handle < FONT_HANDLE_MIN || handle > FONT_HANDLE_MAX)
+	{
+		return false;
+	}
+
+	for(uint8_t i = 0; i < font_cnt; i++)
+	{
+		if(font_map[i].font == font || font_map[i].handle == handle)
+		{
+			font_map[i].font = font;
+			font_map[i].handle = handle;
+			font_map[i].addr = addr;
+			font_map[i].firstchar = firstchar;
+			return true;
+		}
+	}
+
+	if(font_cnt >= (sizeof(font_map) / sizeof(font_map[0])))
+	{
+		return false;
+	}
+
+	font_map[font_cnt].font = font;
+	font_map[font_cnt].handle = handle;
+	font_map[font_cnt].addr = addr;
+	font_map[font_cnt].firstchar = firstchar;
+	font_cnt++;
+	return true;
+}
+
+
+bool FT81x_draw_load_font(const lv_font_t * font, uint8_t handle, const uint8_t * data, uint32_t len, uint8_t firstchar)
+{
+	uint32_t addr;
+
+	if(!FT81x_ramg_find(data, len, &addr))
+	{
+		addr = FT81x_ramg_alloc(data, len);
+		if(addr == FT81X_RAMG_NONE)
+		{
+			return false;
+		}
+
+		if(!FT81x_ramg_write(addr, data, len))
+		{
+			FT81x_ramg_free(addr);
+			return false;
+		}
+	}
+
+	return FT81x_draw_add_font(font, handle, addr, firstchar);
+}
+
+
+bool FT81x_draw_snippet_attach(lv_obj_t * obj)
+{
+	if(snippet_find(obj) != NULL)
+	{
+		return true;
+	}
+
+	// with a smaller draw buffer LvGL draws the screen in bands and the object once per band,
+	// its recording would only hold the band it was made in
+	lv_disp_drv_t * drv = lv_obj_get_disp(obj)->driver;
+	if(drv->draw_buf->size < (uint32_t) drv->hor_res * drv->ver_res)
+	{
+		ESP_LOGW(LOG_TAG, "snippets need a draw buffer of the size of the screen");
+		return false;
+	}
+
+	snippet_t * snip = snippet_find(NULL);
+	if(snip == NULL)
+	{
+		return false;
+	}
+
+	memset(snip, 0, sizeof(snippet_t));
+	snip->obj = obj;
+	lv_area_copy(&snip->area, &obj->coords);
+	lv_obj_add_event_cb(obj, snippet_event_cb, LV_EVENT_ALL, NULL);
+	return true;
+}
+
+
+void FT81x_draw_snippet_invalidate(lv_obj_t * obj)
+{
+	snippet_t * snip = snippet_find(obj);
+
+	if(snip != NULL)
+	{
+		snip->state = SNIPPET_CHANGED;
+	}
+}
+
+
+void FT81x_draw_snippet_detach(lv_obj_t * obj)
+{
+	snippet_t * snip = snippet_find(obj);
+
+	if(snip != NULL)
+	{
+		lv_obj_remove_event_cb(obj, snippet_event_cb);
+		snippet_drop(snip);
+		snip->obj = NULL;
+	}
+}
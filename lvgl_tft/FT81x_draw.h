@@ -0,0 +1,46 @@
+#ifndef FT81X_DRAW_H_
+#define FT81X_DRAW_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef LV_LVGL_H_INCLUDE_SIMPLE
+#include "lvgl.h"
+#else
+#include "lvgl/lvgl.h"
+#endif
+
+/* LvGL draw backend that builds an EVE display-list instead of rendering pixels (CONFIG_LV_FT81X_DL_RENDERER) */
+
+/* call after lv_disp_drv_init(), sets the draw context callbacks and the full-screen rounder */
+void FT81x_draw_init_drv(lv_disp_drv_t * drv);
+
+void FT81x_draw_ctx_init(lv_disp_drv_t * drv, lv_draw_ctx_t * draw_ctx);
+void FT81x_draw_ctx_deinit(lv_disp_drv_t * drv, lv_draw_ctx_t * draw_ctx);
+
+/* every frame is a complete display-list, so every refresh has to cover the whole screen */
+void FT81x_draw_rounder(lv_disp_drv_t * drv, lv_area_t * area);
+
+/* terminate the display-list of the current frame and swap it in, called from FT81x_flush() */
+void FT81x_draw_frame_end(void);
+
+/* render "font" with the EVE font already placed in RAM_G at "addr" (legacy font format, see CMD_SETFONT2) */
+/* handles 1 to 14 are available, LvGL fonts that are not registered fall back to the closest ROM font */
+bool FT81x_draw_add_font(const lv_font_t * font, uint8_t handle, uint32_t addr, uint8_t firstchar);
+
+/* same, but the EVE font is uploaded from "data" to the RAM_G heap first, see FT81x_ramg.h for other assets */
+bool FT81x_draw_load_font(const lv_font_t * font, uint8_t handle, const uint8_t * data, uint32_t len, uint8_t firstchar);
+
+/* record what "obj" and its children draw into RAM_G once and replay it with CMD_APPEND in the following frames */
+/* meant for static parts of the screen, anything invalidated over the object (itself, a child or an object on top) */
+/* drops the recording, it is made again once the object was drawn a frame without changes */
+/* up to 8 objects, images in it have to be in flash or in fixed RAM_G allocations to be recorded */
+/* needs a draw buffer of the size of the screen, returns false otherwise */
+bool FT81x_draw_snippet_attach(lv_obj_t * obj);
+
+/* record again, for changes that do not invalidate the object */
+void FT81x_draw_snippet_invalidate(lv_obj_t * obj);
+
+void FT81x_draw_snippet_detach(lv_obj_t * obj);
+
+#endif /* FT81X_DRAW_H_ */
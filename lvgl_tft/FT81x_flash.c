@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+
+#include "FT81x_flash.h"
+#include "FT81x_draw.h"
+#include "FT81x_ramg.h"
+
+#include "EVE.h"
+#include "EVE_commands.h"
+
+#if !defined (BT81X_ENABLE)
+#error "CONFIG_LV_FT81X_FLASH_ASSETS needs a BT81x board with external flash"
+#endif
+
+#define LOG_TAG "FT81x_flash"
+
+#define INDEX_ADDR		0x1000UL	// behind the 4 kB flash blob
+#define INDEX_MAGIC		0x41455645UL	// "EVEA"
+#define INDEX_HEADER	16
+
+// flash images use a color format LvGL does not know, so LvGL does not try to decode them
+#define FLASH_IMG_CF	LV_IMG_CF_USER_ENCODED_0
+
+static FT81x_flash_asset_t * assets = NULL;
+static uint16_t asset_cnt = 0;
+
+
+// CMD_FLASHREAD needs a 64 byte aligned source and a size that is a multiple of 4
+static void flash_read(uint32_t dest, uint32_t src, uint32_t num)
+{
+	EVE_cmd_flashread(dest, src, (num + 3) & ~3UL);
+}
+
+
+static bool index_read(void)
+{
+	uint32_t tmp = FT81x_ramg_alloc(NULL, 64);
+	if(tmp == FT81X_RAMG_NONE)
+	{
+		return false;
+	}
+
+	flash_read(tmp, INDEX_ADDR, 64);
+	uint32_t magic = EVE_memRead32(tmp);
+	uint32_t info = EVE_memRead32(tmp + 4);	// version and count
+	FT81x_ramg_free(tmp);
+
+	if(magic != INDEX_MAGIC || (info & 0xffff) != 1)
+	{
+		ESP_LOGE(LOG_TAG, "no asset index in flash");
+		return false;
+	}
+
+	uint16_t cnt = info >> 16;
+	uint32_t len = INDEX_HEADER + cnt * sizeof(FT81x_flash_asset_t);
+
+	assets = malloc(cnt * sizeof(FT81x_flash_asset_t));
+	tmp = FT81x_ramg_alloc(NULL, (len + 63) & ~63UL);
+	if(assets == NULL || tmp == FT81X_RAMG_NONE)
+	{
+		free(assets);
+		assets = NULL;
+		FT81x_ramg_free(tmp);
+		return false;
+	}
+
+	flash_read(tmp, INDEX_ADDR, len);
+
+	uint32_t * dst = (uint32_t *) assets;
+	for(uint32_t i = 0; i < (cnt * sizeof(FT81x_flash_asset_t)) / 4; i++)
+	{
+		dst[i] = EVE_memRead32(tmp + INDEX_HEADER + (i * 4));
+	}
+	FT81x_ramg_free(tmp);
+
+	for(uint16_t i = 0; i < cnt; i++)
+	{
+		assets[i].name[sizeof(assets[i].name) - 1] = '\0';
+	}
+
+	asset_cnt = cnt;
+	return true;
+}
+
+
+static lv_res_t flash_img_info(lv_img_decoder_t * decoder, const void * src, lv_img_header_t * header)
+{
+	if(lv_img_src_get_type(src) != LV_IMG_SRC_VARIABLE || ((const lv_img_dsc_t *) src)->header.cf != FLASH_IMG_CF)
+	{
+		return LV_RES_INV;
+	}
+
+	*header = ((const lv_img_dsc_t *) src)->header;
+	return LV_RES_OK;
+}
+
+
+// nothing to decode, the renderer gets the index entry as image data
+static lv_res_t flash_img_open(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc)
+{
+	if(dsc->src_type != LV_IMG_SRC_VARIABLE || ((const lv_img_dsc_t *) dsc->src)->header.cf != FLASH_IMG_CF)
+	{
+		return LV_RES_INV;
+	}
+
+	dsc->img_data = ((const lv_img_dsc_t *) dsc->src)->data;
+	return LV_RES_OK;
+}
+
+
+bool FT81x_flash_init(void)
+{
+	if(assets != NULL)
+	{
+		return true;
+	}
+
+	if(!EVE_init_flash())
+	{
+		ESP_LOGE(LOG_TAG, "flash not found or CMD_FLASHFAST failed, is the flash blob in place?");
+		return false;
+	}
+
+	if(!index_read())
+	{
+		return false;
+	}
+
+	lv_img_decoder_t * dec = lv_img_decoder_create();
+	lv_img_decoder_set_info_cb(dec, flash_img_info);
+	lv_img_decoder_set_open_cb(dec, flash_img_open);
+
+	ESP_LOGI(LOG_TAG, "%u assets in flash", asset_cnt);
+	return true;
+}
+
+
+const FT81x_flash_asset_t * FT81x_flash_find(const char * name)
+{
+	for(uint16_t i = 0; i < asset_cnt; i++)
+	{
+		if(strcmp(assets[i].name, name) == 0)
+		{
+			return &assets[i];
+		}
+	}
+	return NULL;
+}
+
+
+bool FT81x_flash_img(const char * name, lv_img_dsc_t * dsc)
+{
+	const FT81x_flash_asset_t * asset = FT81x_flash_find(name);
+
+	if(asset == NULL || asset->format == 0)
+	{
+		return false;
+	}
+
+	memset(dsc, 0, sizeof(lv_img_dsc_t));
+	dsc->header.cf = FLASH_IMG_CF;
+	dsc->header.w = asset->width;
+	dsc->header.h = asset->height;
+	dsc->data = (const uint8_t *) asset;
+	dsc->data_size = sizeof(FT81x_flash_asset_t);
+	return true;
+}
+
+
+bool FT81x_flash_load_font(const char * name, const lv_font_t * font, uint8_t handle, uint8_t firstchar)
+{
+	const FT81x_flash_asset_t * asset = FT81x_flash_find(name);
+	uint32_t addr;
+
+	if(asset == NULL)
+	{
+		return false;
+	}
+
+	if(!FT81x_ramg_find(asset, asset->size, &addr))
+	{
+		addr = FT81x_ramg_alloc(asset, asset->size);
+		if(addr == FT81X_RAMG_NONE)
+		{
+			return false;
+		}
+		flash_read(addr, asset->addr, asset->size);
+	}
+
+	return FT81x_draw_add_font(font, handle, addr, firstchar);
+}
+
+
+const FT81x_flash_asset_t * FT81x_flash_asset_of(const void * data)
+{
+	const FT81x_flash_asset_t * asset = (const FT81x_flash_asset_t *) data;
+
+	if(assets != NULL && asset >= assets && asset < &assets[asset_cnt])
+	{
+		return asset;
+	}
+	return NULL;
+}
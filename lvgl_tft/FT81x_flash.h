@@ -0,0 +1,44 @@
+#ifndef FT81X_FLASH_H_
+#define FT81X_FLASH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef LV_LVGL_H_INCLUDE_SIMPLE
+#include "lvgl.h"
+#else
+#include "lvgl/lvgl.h"
+#endif
+
+/* Assets in the external flash of BT81x boards, packed with tools/eve_flash_pack.py (CONFIG_LV_FT81X_FLASH_ASSETS) */
+
+/* index entry as written by the packer */
+typedef struct {
+	char name[16];
+	uint32_t addr;		// byte address in the flash, 64 byte aligned
+	uint32_t size;
+	uint16_t format;	// EVE bitmap format, 0 for raw data
+	uint16_t width;
+	uint16_t height;
+	uint16_t reserved;
+} FT81x_flash_asset_t;
+
+/* BITMAP_SOURCE / CMD_SETBITMAP address of data in flash */
+#define FT81X_FLASH_BITMAP_ADDR(addr)	(0x800000UL | ((addr) >> 5))
+
+/* switch the flash to full speed and read the index, call after FT81x_init() and before LvGL draws */
+bool FT81x_flash_init(void);
+
+const FT81x_flash_asset_t * FT81x_flash_find(const char * name);
+
+/* fill "dsc" so that lv_img_set_src(img, dsc) draws the ASTC bitmap "name" straight from flash */
+/* these images can only be drawn by the display-list renderer, not into layers */
+bool FT81x_flash_img(const char * name, lv_img_dsc_t * dsc);
+
+/* copy a legacy font from flash to the RAM_G heap and register it, see FT81x_draw_add_font() */
+bool FT81x_flash_load_font(const char * name, const lv_font_t * font, uint8_t handle, uint8_t firstchar);
+
+/* the asset behind image data handed to the renderer, NULL if "data" is not a flash image */
+const FT81x_flash_asset_t * FT81x_flash_asset_of(const void * data);
+
+#endif /* FT81X_FLASH_H_ */
@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "FT81x_media.h"
+
+#include "EVE.h"
+#include "EVE_commands.h"
+
+#include "disp_spi.h"
+
+#define LOG_TAG "FT81x_media"
+
+// the media-fifo sits at the top of RAM_G
+#define MEDIAFIFO_SIZE	(CONFIG_LV_FT81X_MEDIAFIFO_KB * 1024L)
+#define MEDIAFIFO_ADDR	((EVE_RAM_G_SIZE) - MEDIAFIFO_SIZE)
+
+#if (MEDIAFIFO_SIZE & (MEDIAFIFO_SIZE - 1)) != 0
+#error "CONFIG_LV_FT81X_MEDIAFIFO_KB has to be a power of two"
+#endif
+
+#define CHUNK_SIZE		4096	// two of these are used in turns, one is read into while the other one is sent
+#define TASK_STACK		3072
+#define STALL_MS		1000	// the co-processor is given up on when it takes nothing from the fifo for this long
+#define TASK_PRIO		5
+
+typedef struct {
+	FT81x_media_source_t src;
+	uint32_t command;	// CMD_LOADIMAGE or CMD_PLAYVIDEO
+	uint32_t dest;
+	uint32_t options;
+} media_job_t;
+
+typedef struct {
+	uint32_t rd;		// REG_MEDIAFIFO_READ when last seen moving
+	TickType_t since;
+} media_stall_t;
+
+static media_job_t job;
+static SemaphoreHandle_t done_sem = NULL;
+static volatile bool running = false;
+static bool result = false;
+
+
+int32_t FT81x_media_read_file(void * user, uint8_t * buf, uint32_t len)
+{
+	FILE * f = (FILE *) user;
+	size_t n = fread(buf, 1, len, f);
+
+	if(n == 0 && ferror(f))
+	{
+		return -1;
+	}
+	return (int32_t) n;
+}
+
+
+int32_t FT81x_media_read_partition(void * user, uint8_t * buf, uint32_t len)
+{
+	FT81x_media_partition_t * p = (FT81x_media_partition_t *) user;
+
+	if(len > p->size)
+	{
+		len = p->size;
+	}
+
+	if(len > 0)
+	{
+		if(esp_partition_read(p->partition, p->offset, buf, len) != ESP_OK)
+		{
+			return -1;
+		}
+		p->offset += len;
+		p->size -= len;
+	}
+	return (int32_t) len;
+}
+
+
+// bytes the co-processor has not consumed yet, one dword stays free so a full fifo can be told from an empty one
+static uint32_t fifo_free(uint32_t wr)
+{
+	uint32_t rd = EVE_memRead32(REG_MEDIAFIFO_READ);
+
+	return (rd - wr - 4) & (MEDIAFIFO_SIZE - 1);
+}
+
+
+static void stall_reset(media_stall_t * stall)
+{
+	stall->rd = EVE_memRead32(REG_MEDIAFIFO_READ);
+	stall->since = xTaskGetTickCount();
+}
+
+
+// true once the co-processor has not consumed anything from the fifo for STALL_MS
+static bool stalled(media_stall_t * stall)
+{
+	uint32_t rd = EVE_memRead32(REG_MEDIAFIFO_READ);
+
+	if(rd != stall->rd)
+	{
+		stall->rd = rd;
+		stall->since = xTaskGetTickCount();
+		return false;
+	}
+	return (xTaskGetTickCount() - stall->since) >= pdMS_TO_TICKS(STALL_MS);
+}
+
+
+/* reading the source and sending to the fifo overlap: while one chunk is on its way by DMA the next one is read */
+static bool media_stream(void)
+{
+	uint8_t * buf[2];
+	uint32_t wr = 0;
+	uint8_t cur = 0;
+	uint32_t pending = 0;	// bytes of the chunk in flight, REG_MEDIAFIFO_WRITE is moved on once they arrived
+	media_stall_t stall;
+	bool ok = true;
+
+	buf[0] = heap_caps_malloc(CHUNK_SIZE, MALLOC_CAP_DMA);
+	buf[1] = heap_caps_malloc(CHUNK_SIZE, MALLOC_CAP_DMA);
+	if(buf[0] == NULL || buf[1] == NULL)
+	{
+		ESP_LOGE(LOG_TAG, "no memory for the stream buffers");
+		heap_caps_free(buf[0]);
+		heap_caps_free(buf[1]);
+		return false;
+	}
+
+	spi_acquire();
+
+	EVE_cmd_mediafifo(MEDIAFIFO_ADDR, MEDIAFIFO_SIZE);
+	EVE_cmd_execute();
+	EVE_memWrite32(REG_MEDIAFIFO_WRITE, 0);
+
+	if(job.command == CMD_LOADIMAGE)
+	{
+		EVE_cmd_loadimage(job.dest, job.options, NULL, 0);
+	}
+	else
+	{
+		EVE_cmd_playvideo(job.options, NULL, 0);
+	}
+	EVE_cmd_start();
+
+	while(1)
+	{
+		int32_t len = job.src.read(job.src.user, buf[cur], CHUNK_SIZE);
+
+		if(len < 0)
+		{
+			ESP_LOGE(LOG_TAG, "reading the source failed");
+			ok = false;
+		}
+
+		disp_wait_for_pending_transactions();
+		if(pending)
+		{
+			wr = (wr + pending) & (MEDIAFIFO_SIZE - 1);
+			EVE_memWrite32(REG_MEDIAFIFO_WRITE, wr);
+			pending = 0;
+		}
+
+		if(len <= 0)
+		{
+			break;
+		}
+
+		// the fifo is only refilled as far as the co-processor has consumed it
+		uint32_t padded = (len + 3) & ~3UL;
+		stall_reset(&stall);
+		while(fifo_free(wr) < padded)
+		{
+			if(!EVE_busy())
+			{
+				break;	// the co-processor finished early, e.g. the end of the JPEG was reached
+			}
+			if(stalled(&stall))
+			{
+				ESP_LOGE(LOG_TAG, "the co-processor stopped taking data from the fifo");
+				ok = false;
+				break;
+			}
+			vTaskDelay(1);
+		}
+		if(!ok)
+		{
+			break;
+		}
+		memset(&buf[cur][len], 0, padded - len);
+
+		// SPI writes do not wrap around, split at the end of the fifo
+		uint32_t first = MEDIAFIFO_SIZE - wr;
+		if(first >= padded)
+		{
+			EVE_memWrite_buffer(MEDIAFIFO_ADDR + wr, buf[cur], padded, false);
+		}
+		else
+		{
+			EVE_memWrite_buffer(MEDIAFIFO_ADDR + wr, buf[cur], first, false);
+			EVE_memWrite_buffer(MEDIAFIFO_ADDR, buf[cur] + first, padded - first, false);
+		}
+		pending = padded;
+		cur ^= 1;
+	}
+
+	// after a read error or a truncated source the command waits for data that never comes
+	stall_reset(&stall);
+	while(ok && EVE_busy())
+	{
+		if(stalled(&stall))
+		{
+			ESP_LOGE(LOG_TAG, "the stream ended before the co-processor finished");
+			ok = false;
+			break;
+		}
+		vTaskDelay(1);
+	}
+
+	if(!ok && EVE_busy())
+	{
+		EVE_reset_coprocessor();
+	}
+
+	spi_release();
+
+	heap_caps_free(buf[0]);
+	heap_caps_free(buf[1]);
+	return ok;
+}
+
+
+static void media_task(void * arg)
+{
+	result = media_stream();
+	running = false;
+
+	if(job.src.done)
+	{
+		job.src.done(result, job.src.user);
+	}
+
+	xSemaphoreGive(done_sem);
+	vTaskDelete(NULL);
+}
+
+
+static bool media_start(uint32_t command, uint32_t dest, uint32_t options, const FT81x_media_source_t * src)
+{
+	if(running || src == NULL || src->read == NULL)
+	{
+		return false;
+	}
+
+	if(done_sem == NULL)
+	{
+		done_sem = xSemaphoreCreateBinary();
+		if(done_sem == NULL)
+		{
+			return false;
+		}
+	}
+
+	xSemaphoreTake(done_sem, 0);
+
+	job.src = *src;
+	job.command = command;
+	job.dest = dest;
+	job.options = options | EVE_OPT_MEDIAFIFO;
+	running = true;
+
+	if(xTaskCreate(media_task, "FT81x_media", TASK_STACK, NULL, TASK_PRIO, NULL) != pdPASS)
+	{
+		running = false;
+		return false;
+	}
+	return true;
+}
+
+
+bool FT81x_media_load_image(uint32_t dest, uint32_t options, const FT81x_media_source_t * src)
+{
+	return media_start(CMD_LOADIMAGE, dest, options, src);
+}
+
+
+bool FT81x_media_play_video(uint32_t options, const FT81x_media_source_t * src)
+{
+	return media_start(CMD_PLAYVIDEO, 0, options, src);
+}
+
+
+bool FT81x_media_busy(void)
+{
+	return running;
+}
+
+
+bool FT81x_media_wait(void)
+{
+	if(done_sem == NULL)
+	{
+		return false;
+	}
+
+	if(running)
+	{
+		xSemaphoreTake(done_sem, portMAX_DELAY);
+		xSemaphoreGive(done_sem);	// further waits return right away
+	}
+	return result;
+}
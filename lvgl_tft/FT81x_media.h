@@ -0,0 +1,49 @@
+#ifndef FT81X_MEDIA_H_
+#define FT81X_MEDIA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "esp_partition.h"
+
+/* Streams JPEG, PNG or AVI data into the RAM_G media-fifo from a background task, the FT81x decodes it (CONFIG_LV_FT81X_MEDIA) */
+/* The co-processor is busy until the stream ends, LvGL must not refresh the FT81x while a stream is running */
+
+/* returns the number of bytes read into "buf", 0 at the end of the data and < 0 on errors */
+typedef int32_t (*FT81x_media_read_cb_t)(void * user, uint8_t * buf, uint32_t len);
+
+/* called from the streaming task when the stream is done, "ok" is false after a read error or when the co-processor
+   stalled (e.g. a truncated file), it has been reset then */
+typedef void (*FT81x_media_done_cb_t)(bool ok, void * user);
+
+typedef struct {
+	FT81x_media_read_cb_t read;
+	void * user;
+	FT81x_media_done_cb_t done;		// optional
+} FT81x_media_source_t;
+
+/* readers for a file opened with fopen() and for a range of a flash partition */
+typedef struct {
+	const esp_partition_t * partition;
+	uint32_t offset;
+	uint32_t size;
+} FT81x_media_partition_t;
+
+int32_t FT81x_media_read_file(void * user, uint8_t * buf, uint32_t len);		// user is a FILE *
+int32_t FT81x_media_read_partition(void * user, uint8_t * buf, uint32_t len);	// user is a FT81x_media_partition_t *
+
+/* the two functions below both start the streaming task and return right away, false if a stream is already running */
+
+/* decode a JPEG or PNG to "dest" in RAM_G with CMD_LOADIMAGE, "options" as for CMD_LOADIMAGE (EVE_OPT_MEDIAFIFO is added) */
+bool FT81x_media_load_image(uint32_t dest, uint32_t options, const FT81x_media_source_t * src);
+
+/* play an AVI (motion JPEG) with CMD_PLAYVIDEO, e.g. EVE_OPT_FULLSCREEN | EVE_OPT_NOTEAR (EVE_OPT_MEDIAFIFO is added) */
+bool FT81x_media_play_video(uint32_t options, const FT81x_media_source_t * src);
+
+/* true while a stream is running */
+bool FT81x_media_busy(void);
+/* block until the running stream is done, returns its result */
+bool FT81x_media_wait(void);
+
+#endif /* FT81X_MEDIA_H_ */
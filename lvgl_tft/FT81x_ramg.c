@@ -0,0 +1,381 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "soc/soc_memory_layout.h"
+
+#include "FT81x_ramg.h"
+
+#include "EVE.h"
+#include "EVE_commands.h"
+
+#include "disp_spi.h"
+
+#define LOG_TAG "FT81x_ramg"
+
+#define BLOCKS_MAX		64
+#define ALIGN(x)		(((x) + 3) & ~3UL)
+
+typedef struct {
+	const void * key;
+	uint32_t addr;
+	uint32_t size;
+	uint32_t last_used;	// frame number, cache entries only
+	bool cached;		// cache entries may be evicted and moved, fixed allocations stay where they are
+} ramg_block_t;
+
+// allocated blocks sorted by address, the gaps between them are the free space
+static ramg_block_t blocks[BLOCKS_MAX];
+static uint8_t block_cnt = 0;
+static uint32_t frame = 0;
+static uint8_t * bounce = NULL;
+
+
+// the entry may be referenced by the list being built or by the one on screen
+static inline bool block_busy(const ramg_block_t * b)
+{
+	return (b->last_used + 1) >= frame;
+}
+
+
+static inline uint32_t block_end(uint8_t i)
+{
+	return blocks[i].addr + blocks[i].size;
+}
+
+
+static void block_remove(uint8_t i)
+{
+	memmove(&blocks[i], &blocks[i + 1], (block_cnt - i - 1) * sizeof(ramg_block_t));
+	block_cnt--;
+}
+
+
+// first fit, returns the index the block was inserted at or -1
+static int16_t block_insert(const void * key, uint32_t size, bool cached)
+{
+	uint32_t start = FT81X_RAMG_HEAP_START;
+
+	if(block_cnt >= BLOCKS_MAX)
+	{
+		return -1;
+	}
+
+	for(uint8_t i = 0; i <= block_cnt; i++)
+	{
+		uint32_t end = (i < block_cnt) ? blocks[i].addr : FT81X_RAMG_HEAP_END;
+
+		if((end - start) >= size)
+		{
+			memmove(&blocks[i + 1], &blocks[i], (block_cnt - i) * sizeof(ramg_block_t));
+			blocks[i].key = key;
+			blocks[i].addr = start;
+			blocks[i].size = size;
+			blocks[i].last_used = frame;
+			blocks[i].cached = cached;
+			block_cnt++;
+			return i;
+		}
+
+		if(i < block_cnt)
+		{
+			start = block_end(i);
+		}
+	}
+
+	return -1;
+}
+
+
+static bool cache_evict_lru(void)
+{
+	int16_t lru = -1;
+
+	for(uint8_t i = 0; i < block_cnt; i++)
+	{
+		if(blocks[i].cached && !block_busy(&blocks[i]) && (lru < 0 || blocks[i].last_used < blocks[lru].last_used))
+		{
+			lru = i;
+		}
+	}
+
+	if(lru < 0)
+	{
+		return false;
+	}
+
+	block_remove(lru);
+	return true;
+}
+
+
+/* move idle cache entries down into the gaps in front of them, busy entries and fixed allocations stay put */
+/* CMD_MEMCPY is only used for moves where source and destination do not overlap */
+static bool cache_compact(void)
+{
+	uint32_t start = FT81X_RAMG_HEAP_START;
+	bool moved = false;
+
+	for(uint8_t i = 0; i < block_cnt; i++)
+	{
+		ramg_block_t * b = &blocks[i];
+
+		if(b->cached && !block_busy(b) && (b->addr - start) >= b->size)
+		{
+			EVE_cmd_memcpy(start, b->addr, b->size);
+			b->addr = start;
+			moved = true;
+		}
+
+		start = block_end(i);
+	}
+
+	if(moved)
+	{
+		EVE_cmd_execute();
+	}
+
+	return moved;
+}
+
+
+uint32_t FT81x_ramg_alloc(const void * key, uint32_t size)
+{
+	int16_t i = block_insert(key, ALIGN(size), false);
+
+	// fixed allocations have priority over cached images
+	while(i < 0 && cache_evict_lru())
+	{
+		i = block_insert(key, ALIGN(size), false);
+	}
+
+	if(i < 0)
+	{
+		ESP_LOGW(LOG_TAG, "out of RAM_G for %u bytes", (unsigned) size);
+		return FT81X_RAMG_NONE;
+	}
+
+	return blocks[i].addr;
+}
+
+
+bool FT81x_ramg_is_fixed(uint32_t addr)
+{
+	for(uint8_t i = 0; i < block_cnt; i++)
+	{
+		if(blocks[i].addr == addr)
+		{
+			return !blocks[i].cached;
+		}
+	}
+
+	return false;
+}
+
+
+void FT81x_ramg_free(uint32_t addr)
+{
+	for(uint8_t i = 0; i < block_cnt; i++)
+	{
+		if(blocks[i].addr == addr && !blocks[i].cached)
+		{
+			block_remove(i);
+			return;
+		}
+	}
+}
+
+
+bool FT81x_ramg_find(const void * key, uint32_t size, uint32_t * addr)
+{
+	size = ALIGN(size);
+
+	for(uint8_t i = 0; i < block_cnt; i++)
+	{
+		if(blocks[i].key == key && blocks[i].size == size)
+		{
+			blocks[i].last_used = frame;
+			*addr = blocks[i].addr;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+uint32_t FT81x_ramg_cache_alloc(const void * key, uint32_t size)
+{
+	size = ALIGN(size);
+
+	if(size > (FT81X_RAMG_HEAP_END - FT81X_RAMG_HEAP_START))
+	{
+		return FT81X_RAMG_NONE;
+	}
+
+	int16_t i = block_insert(key, size, true);
+
+	while(i < 0)
+	{
+		// compacting is more expensive than evicting, only do it when there is nothing left to evict
+		if(!cache_evict_lru() && !cache_compact())
+		{
+			return FT81X_RAMG_NONE;
+		}
+		i = block_insert(key, size, true);
+	}
+
+	return blocks[i].addr;
+}
+
+
+void FT81x_ramg_cache_drop(const void * key)
+{
+	for(uint8_t i = 0; i < block_cnt; )
+	{
+		if(blocks[i].cached && blocks[i].key == key)
+		{
+			block_remove(i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+
+void FT81x_ramg_frame_begin(void)
+{
+	frame++;
+}
+
+
+uint8_t * FT81x_ramg_bounce(void)
+{
+	if(bounce == NULL)
+	{
+		bounce = heap_caps_malloc(FT81X_RAMG_BOUNCE_SIZE, MALLOC_CAP_DMA);
+		if(bounce == NULL)
+		{
+			ESP_LOGE(LOG_TAG, "no memory for the bounce buffer");
+		}
+	}
+
+	return bounce;
+}
+
+
+bool FT81x_ramg_write(uint32_t addr, const uint8_t * data, uint32_t len)
+{
+	if(esp_ptr_dma_capable(data))
+	{
+		EVE_memWrite_buffer(addr, data, len, false);
+		disp_wait_for_pending_transactions();
+		return true;
+	}
+
+	uint8_t * buf = FT81x_ramg_bounce();
+	if(buf == NULL)
+	{
+		return false;
+	}
+
+	while(len > 0)
+	{
+		uint32_t chunk = (len > FT81X_RAMG_BOUNCE_SIZE) ? FT81X_RAMG_BOUNCE_SIZE : len;
+
+		memcpy(buf, data, chunk);
+		EVE_memWrite_buffer(addr, buf, chunk, false);
+		disp_wait_for_pending_transactions();	// the buffer is reused for the next chunk
+
+		addr += chunk;
+		data += chunk;
+		len -= chunk;
+	}
+
+	return true;
+}
+
+
+// the co-processor reads the compressed data from the command-fifo by DMA
+static const uint8_t * dma_copy(const uint8_t * data, uint32_t len)
+{
+	if(esp_ptr_dma_capable(data))
+	{
+		return data;
+	}
+
+	uint8_t * copy = heap_caps_malloc(len, MALLOC_CAP_DMA);
+	if(copy != NULL)
+	{
+		memcpy(copy, data, len);
+	}
+	return copy;
+}
+
+
+uint32_t FT81x_ramg_load_inflate(const void * key, const uint8_t * data, uint32_t len, uint32_t size)
+{
+	if(len > 0xffff)
+	{
+		return FT81X_RAMG_NONE;
+	}
+
+	uint32_t addr = FT81x_ramg_alloc(key, size);
+	if(addr == FT81X_RAMG_NONE)
+	{
+		return FT81X_RAMG_NONE;
+	}
+
+	const uint8_t * src = dma_copy(data, len);
+	if(src == NULL)
+	{
+		FT81x_ramg_free(addr);
+		return FT81X_RAMG_NONE;
+	}
+
+	EVE_cmd_inflate(addr, src, len);
+	EVE_cmd_execute();
+
+	if(src != data)
+	{
+		heap_caps_free((void *) src);
+	}
+
+	return addr;
+}
+
+
+uint32_t FT81x_ramg_load_image(const void * key, const uint8_t * data, uint32_t len, uint32_t size, uint32_t options)
+{
+	if(len > 0xffff)
+	{
+		return FT81X_RAMG_NONE;
+	}
+
+	uint32_t addr = FT81x_ramg_alloc(key, size);
+	if(addr == FT81X_RAMG_NONE)
+	{
+		return FT81X_RAMG_NONE;
+	}
+
+	const uint8_t * src = dma_copy(data, len);
+	if(src == NULL)
+	{
+		FT81x_ramg_free(addr);
+		return FT81X_RAMG_NONE;
+	}
+
+	// OPT_NODL, the bitmap setup is done by the renderer for every frame
+	EVE_cmd_loadimage(addr, options | EVE_OPT_NODL, src, len);
+	EVE_cmd_execute();
+
+	if(src != data)
+	{
+		heap_caps_free((void *) src);
+	}
+
+	return addr;
+}
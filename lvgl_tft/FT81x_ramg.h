@@ -0,0 +1,57 @@
+#ifndef FT81X_RAMG_H_
+#define FT81X_RAMG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "EVE.h"
+
+/* RAM_G layout of the display-list renderer (CONFIG_LV_FT81X_DL_RENDERER):
+   0 .. FT81X_RAMG_HEAP_END		heap for fonts, preloaded assets and the image cache
+   FT81X_RAMG_SCRATCH_ADDR .. end	scratch for images that can not be cached, see FT81x_draw.c */
+#define FT81X_RAMG_SCRATCH_SIZE	(CONFIG_LV_FT81X_DL_SCRATCH_KB * 1024L)
+#define FT81X_RAMG_SCRATCH_ADDR	((EVE_RAM_G_SIZE) - FT81X_RAMG_SCRATCH_SIZE)
+#define FT81X_RAMG_HEAP_START	0L
+#if defined (CONFIG_LV_FT81X_MEDIA) && (CONFIG_LV_FT81X_MEDIAFIFO_KB > CONFIG_LV_FT81X_DL_SCRATCH_KB)
+#define FT81X_RAMG_HEAP_END		((EVE_RAM_G_SIZE) - (CONFIG_LV_FT81X_MEDIAFIFO_KB * 1024L))	// keep clear of the media-fifo
+#else
+#define FT81X_RAMG_HEAP_END		FT81X_RAMG_SCRATCH_ADDR
+#endif
+
+#define FT81X_RAMG_NONE			0xffffffffUL	// returned when an allocation fails
+
+#define FT81X_RAMG_BOUNCE_SIZE	4096	// DMA capable buffer used to write data that is not DMA capable itself
+
+/* fixed allocations are never moved or evicted, "key" may be NULL or identify the data for FT81x_ramg_find() */
+uint32_t FT81x_ramg_alloc(const void * key, uint32_t size);
+void FT81x_ramg_free(uint32_t addr);
+
+/* true if "addr" is the start of a fixed allocation, data there stays in place for as long as it is allocated */
+bool FT81x_ramg_is_fixed(uint32_t addr);
+
+/* look up a fixed allocation or a cache entry, a cache entry found is marked as used by the current frame */
+bool FT81x_ramg_find(const void * key, uint32_t size, uint32_t * addr);
+
+/* allocate a cache entry, least recently used entries are evicted and the cache is compacted when needed */
+/* only entries not used by the list on screen or the list being built are touched, call it after the previous swap is done */
+uint32_t FT81x_ramg_cache_alloc(const void * key, uint32_t size);
+
+/* forget all cache entries for "key", for image data that changed */
+void FT81x_ramg_cache_drop(const void * key);
+
+/* start of a new display-list, used to tell which cache entries may still be on screen */
+void FT81x_ramg_frame_begin(void);
+
+/* write to RAM_G and wait for it, data that is not DMA capable is copied through a bounce buffer */
+bool FT81x_ramg_write(uint32_t addr, const uint8_t * data, uint32_t len);
+
+/* the bounce buffer, for callers that convert data before writing it, NULL if it could not be allocated */
+uint8_t * FT81x_ramg_bounce(void);
+
+/* fixed allocations filled by the co-processor, to be called outside of display-list building */
+/* zlib compressed data with CMD_INFLATE, "size" is the inflated size */
+uint32_t FT81x_ramg_load_inflate(const void * key, const uint8_t * data, uint32_t len, uint32_t size);
+/* JPEG or PNG with CMD_LOADIMAGE, "size" is the decoded size */
+uint32_t FT81x_ramg_load_image(const void * key, const uint8_t * data, uint32_t len, uint32_t size, uint32_t options);
+
+#endif /* FT81X_RAMG_H_ */
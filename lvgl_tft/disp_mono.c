@@ -0,0 +1,360 @@
+/**
+ * @file disp_mono.c
+ *
+ * Packing of LVGL render buffers for monochrome controllers with page-organized RAM.
+ *
+ * Every 8x8 block of pixels is first collected into one 64 bit word, one byte per
+ * row with bit n set for a dark pixel in column n. Controllers with horizontal pages
+ * take these row bytes as they are, for vertical pages the word is transposed so
+ * that every byte holds one column. E-paper rotation works on the same blocks: a
+ * transpose plus a bit mirror turns the block by 90 degrees, so the frame is written
+ * 8 rows at a time instead of pixel by pixel. Gray levels are split into two such
+ * blocks, one per bit plane, before they are rotated.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+
+#include "disp_mono.h"
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static inline uint8_t row_bits(const lv_color_t * px, uint8_t n);
+static inline uint64_t row_levels(const lv_color_t * px, uint8_t n);
+static inline uint8_t gather8(uint64_t v);
+static void put_block(uint64_t block, disp_mono_rot_t rot, lv_coord_t sx, lv_coord_t sy, uint8_t rows, uint8_t cols,
+    uint8_t * frame, uint16_t row_stride, uint16_t byte_stride);
+static void rotate_area(const lv_area_t * area, disp_mono_rot_t rot, lv_area_t * frame_area);
+static inline uint64_t transpose8(uint64_t x);
+static inline uint64_t mirror8(uint64_t x);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+#if LV_COLOR_DEPTH == 8
+static uint8_t level_lut[256];
+static bool level_lut_valid = false;
+#endif
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+void disp_mono_round_vpages(lv_area_t * area)
+{
+    area->y1 &= ~0x7;
+    area->y2 |= 0x7;
+}
+
+void disp_mono_round_hpages(lv_area_t * area)
+{
+    area->x1 &= ~0x7;
+    area->x2 |= 0x7;
+}
+
+void disp_mono_pack_vpages(const lv_area_t * area, const lv_color_t * color_map, uint8_t * dst)
+{
+    lv_coord_t w = lv_area_get_width(area);
+    lv_coord_t h = lv_area_get_height(area);
+
+    for (lv_coord_t y = 0; y < h; y += 8) {
+        const lv_color_t * src = color_map + y * w;
+
+        for (lv_coord_t x = 0; x < w; x += 8) {
+            uint8_t n = (w - x) < 8 ? (w - x) : 8;
+            uint64_t block = 0;
+
+            for (uint8_t r = 0; r < 8; r++) {
+                block |= (uint64_t) row_bits(src + r * w + x, n) << (r * 8);
+            }
+
+            block = transpose8(block);
+            for (uint8_t c = 0; c < n; c++) {
+                dst[x + c] = (uint8_t) (block >> (c * 8));
+            }
+        }
+
+        dst += w;
+    }
+}
+
+void disp_mono_pack_hpages(const lv_area_t * area, const lv_color_t * color_map, uint8_t * dst)
+{
+    lv_coord_t w = lv_area_get_width(area);
+    lv_coord_t h = lv_area_get_height(area);
+
+    for (lv_coord_t x = 0; x < w; x += 8) {
+        uint8_t n = (w - x) < 8 ? (w - x) : 8;
+
+        for (lv_coord_t y = 0; y < h; y++) {
+            *dst++ = row_bits(color_map + y * w + x, n);
+        }
+    }
+}
+
+void disp_mono_round_rows(lv_area_t * area, disp_mono_rot_t rot)
+{
+    if (rot == DISP_MONO_ROT_0 || rot == DISP_MONO_ROT_180) {
+        disp_mono_round_hpages(area);
+    } else {
+        disp_mono_round_vpages(area);
+    }
+}
+
+void disp_mono_pack_rows(const lv_area_t * area, const lv_color_t * color_map, disp_mono_rot_t rot,
+    uint8_t * frame, uint16_t row_stride, uint16_t byte_stride, lv_area_t * frame_area)
+{
+    lv_coord_t w = lv_area_get_width(area);
+    lv_coord_t h = lv_area_get_height(area);
+
+    rotate_area(area, rot, frame_area);
+
+    for (lv_coord_t y = 0; y < h; y += 8) {
+        const lv_color_t * src = color_map + y * w;
+        uint8_t rows = (h - y) < 8 ? (h - y) : 8;
+
+        for (lv_coord_t x = 0; x < w; x += 8) {
+            uint8_t cols = (w - x) < 8 ? (w - x) : 8;
+            uint64_t block = 0;
+
+            for (uint8_t r = 0; r < rows; r++) {
+                block |= (uint64_t) row_bits(src + r * w + x, cols) << (r * 8);
+            }
+
+            put_block(~block, rot, area->x1 + x, area->y1 + y, rows, cols, frame, row_stride, byte_stride);
+        }
+    }
+}
+
+void disp_mono_pack_planes(const lv_area_t * area, const lv_color_t * color_map, disp_mono_rot_t rot,
+    uint8_t * plane_hi, uint8_t * plane_lo, uint16_t row_stride, uint16_t byte_stride, lv_area_t * frame_area)
+{
+    lv_coord_t w = lv_area_get_width(area);
+    lv_coord_t h = lv_area_get_height(area);
+
+#if LV_COLOR_DEPTH == 8
+    if (!level_lut_valid) {
+        for (uint16_t i = 0; i < 256; i++) {
+            lv_color_t c;
+            c.full = i;
+            level_lut[i] = (lv_color_brightness(c) * 3 + 127) / 255;
+        }
+        level_lut_valid = true;
+    }
+#endif
+
+    rotate_area(area, rot, frame_area);
+
+    for (lv_coord_t y = 0; y < h; y += 8) {
+        const lv_color_t * src = color_map + y * w;
+        uint8_t rows = (h - y) < 8 ? (h - y) : 8;
+
+        for (lv_coord_t x = 0; x < w; x += 8) {
+            uint8_t cols = (w - x) < 8 ? (w - x) : 8;
+            uint64_t hi = 0;
+            uint64_t lo = 0;
+
+            for (uint8_t r = 0; r < rows; r++) {
+                uint64_t levels = row_levels(src + r * w + x, cols);
+                hi |= (uint64_t) gather8(levels >> 1) << (r * 8);
+                lo |= (uint64_t) gather8(levels) << (r * 8);
+            }
+
+            put_block(hi, rot, area->x1 + x, area->y1 + y, rows, cols, plane_hi, row_stride, byte_stride);
+            put_block(lo, rot, area->x1 + x, area->y1 + y, rows, cols, plane_lo, row_stride, byte_stride);
+        }
+    }
+}
+
+uint32_t disp_mono_shadow_send(disp_mono_shadow_t * shadow, uint8_t page1, uint8_t page2, uint16_t column,
+    uint16_t width, const uint8_t * data, disp_mono_send_cb_t send)
+{
+    uint32_t sent = 0;
+    bool full = !shadow->valid;
+
+    for (uint8_t page = page1; page <= page2; page++) {
+        uint8_t * old = shadow->data + page * shadow->columns + column;
+        uint16_t x = 0;
+
+        while (x < width) {
+            /* skip what the controller already shows */
+            while (!full && x < width && data[x] == old[x]) {
+                x++;
+            }
+            if (x == width) {
+                break;
+            }
+
+            /* extend the run over short stretches of unchanged bytes */
+            uint16_t start = x;
+            uint16_t end = x + 1;
+            for (x = end; x < width && (full || (x - end) <= shadow->gap); x++) {
+                if (data[x] != old[x]) {
+                    end = x + 1;
+                }
+            }
+            if (full) {
+                end = width;
+            }
+            x = end;
+
+            send(page, column + start, data + start, end - start);
+            memcpy(old + start, data + start, end - start);
+            sent += end - start;
+        }
+
+        data += width;
+    }
+
+    if (page1 == 0 && page2 == shadow->pages - 1 && column == 0 && width == shadow->columns) {
+        shadow->valid = true;
+    }
+
+    return sent;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/* bit n set for a dark pixel n of the first "n" pixels */
+static inline uint8_t row_bits(const lv_color_t * px, uint8_t n)
+{
+#if LV_COLOR_DEPTH == 1
+    if (n == 8) {
+        /* one byte of 0 or 1 per pixel, gather the inverted LSBs */
+        uint64_t v;
+        memcpy(&v, px, sizeof(v));
+        return gather8(~v);
+    }
+#endif
+
+    uint8_t bits = 0;
+    for (uint8_t i = 0; i < n; i++) {
+#if LV_COLOR_DEPTH == 1
+        if (px[i].full == 0) {
+#else
+        if (lv_color_brightness(px[i]) < 128) {
+#endif
+            bits |= 1U << i;
+        }
+    }
+    return bits;
+}
+
+/* Gray level 0 (black) to 3 (white) of the first "n" pixels, one byte per pixel */
+static inline uint64_t row_levels(const lv_color_t * px, uint8_t n)
+{
+    uint64_t levels = 0;
+
+    for (uint8_t i = 0; i < n; i++) {
+#if LV_COLOR_DEPTH == 1
+        uint64_t level = px[i].full ? 3 : 0;
+#elif LV_COLOR_DEPTH == 8
+        uint64_t level = level_lut[px[i].full];
+#else
+        uint64_t level = (lv_color_brightness(px[i]) * 3 + 127) / 255;
+#endif
+        levels |= level << (i * 8);
+    }
+    return levels;
+}
+
+/* Bit n = LSB of byte n */
+static inline uint8_t gather8(uint64_t v)
+{
+    v &= 0x0101010101010101ULL;
+    return (uint8_t) ((v * 0x0102040810204080ULL) >> 56);
+}
+
+/* Write one 8x8 block (byte = row, bit n = column n, set for white) of the LVGL screen at sx/sy into the
+ * rotated frame. 0/180 degrees: the area is a whole number of bytes wide, rows may be missing.
+ * 90/270 degrees: the area is a whole number of bytes high, columns may be missing. */
+static void put_block(uint64_t block, disp_mono_rot_t rot, lv_coord_t sx, lv_coord_t sy, uint8_t rows, uint8_t cols,
+    uint8_t * frame, uint16_t row_stride, uint16_t byte_stride)
+{
+    const lv_coord_t hor = LV_HOR_RES_MAX;
+    const lv_coord_t ver = LV_VER_RES_MAX;
+
+    switch (rot) {
+    case DISP_MONO_ROT_0: {
+        uint8_t * dst = frame + sy * row_stride + (sx >> 3) * byte_stride;
+        block = mirror8(block);
+        for (uint8_t r = 0; r < rows; r++) {
+            dst[r * row_stride] = (uint8_t) (block >> (r * 8));
+        }
+        break;
+    }
+    case DISP_MONO_ROT_180: {
+        uint8_t * dst = frame + (ver - 1 - sy) * row_stride + ((hor - 8 - sx) >> 3) * byte_stride;
+        for (uint8_t r = 0; r < rows; r++) {
+            *(dst - r * row_stride) = (uint8_t) (block >> (r * 8));
+        }
+        break;
+    }
+    case DISP_MONO_ROT_90: {
+        uint8_t * dst = frame + sx * row_stride + ((ver - 8 - sy) >> 3) * byte_stride;
+        block = transpose8(block);
+        for (uint8_t c = 0; c < cols; c++) {
+            dst[c * row_stride] = (uint8_t) (block >> (c * 8));
+        }
+        break;
+    }
+    case DISP_MONO_ROT_270: {
+        uint8_t * dst = frame + (hor - 1 - sx) * row_stride + (sy >> 3) * byte_stride;
+        block = mirror8(transpose8(block));
+        for (uint8_t c = 0; c < cols; c++) {
+            *(dst - c * row_stride) = (uint8_t) (block >> (c * 8));
+        }
+        break;
+    }
+    }
+}
+
+static void rotate_area(const lv_area_t * area, disp_mono_rot_t rot, lv_area_t * frame_area)
+{
+    const lv_coord_t hor = LV_HOR_RES_MAX;
+    const lv_coord_t ver = LV_VER_RES_MAX;
+
+    switch (rot) {
+    case DISP_MONO_ROT_90:
+        lv_area_set(frame_area, ver - 1 - area->y2, area->x1, ver - 1 - area->y1, area->x2);
+        break;
+    case DISP_MONO_ROT_180:
+        lv_area_set(frame_area, hor - 1 - area->x2, ver - 1 - area->y2, hor - 1 - area->x1, ver - 1 - area->y1);
+        break;
+    case DISP_MONO_ROT_270:
+        lv_area_set(frame_area, area->y1, hor - 1 - area->x2, area->y2, hor - 1 - area->x1);
+        break;
+    default:
+        lv_area_copy(frame_area, area);
+        break;
+    }
+}
+
+/* 8x8 bit matrix transpose, byte = row and bit = column in and out (Hacker's Delight 7-3) */
+static inline uint64_t transpose8(uint64_t x)
+{
+    uint64_t t;
+
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x ^= t ^ (t << 28);
+
+    return x;
+}
+
+/* Reverse the bits of every byte, MSB first <-> LSB first */
+static inline uint64_t mirror8(uint64_t x)
+{
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+
+    return x;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file disp_mono.h
+ *
+ * Packing of LVGL render buffers for monochrome controllers with page-organized RAM
+ * (SSD1306, SH1107, PCD8544) and for e-paper RAM (IL3820, JD79653A, UC8151D).
+ */
+
+#ifndef DISP_MONO_H
+#define DISP_MONO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef LV_LVGL_H_INCLUDE_SIMPLE
+#include "lvgl.h"
+#else
+#include "lvgl/lvgl.h"
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Bytes needed for a packed copy of the whole screen, for either page orientation */
+#define DISP_MONO_BUF_SIZE  (((LV_HOR_RES_MAX + 7) / 8) * ((LV_VER_RES_MAX + 7) / 8) * 8)
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* Clockwise rotation of the LVGL screen on the panel */
+typedef enum {
+    DISP_MONO_ROT_0,
+    DISP_MONO_ROT_90,
+    DISP_MONO_ROT_180,
+    DISP_MONO_ROT_270,
+} disp_mono_rot_t;
+
+/* Write "len" bytes to one page of the controller, starting at "column" */
+typedef void (*disp_mono_send_cb_t)(uint8_t page, uint16_t column, const uint8_t * data, uint16_t len);
+
+/* Copy of the page data last sent to the controller */
+typedef struct {
+    uint8_t * data;     /* pages * columns bytes */
+    uint16_t columns;
+    uint8_t pages;
+    uint8_t gap;        /* unchanged bytes that are cheaper to send again than opening a new window */
+    bool valid;         /* false until a whole frame has been sent */
+} disp_mono_shadow_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/* The drivers pack in their flush callback when no set_px_cb is installed,
+ * LVGL then renders one lv_color_t per pixel and dark pixels become set bits. */
+static inline bool disp_mono_native(lv_disp_drv_t * drv)
+{
+    return (drv->set_px_cb == NULL);
+}
+
+/* Round to whole pages of 8 rows (vpages) or 8 columns (hpages) */
+void disp_mono_round_vpages(lv_area_t * area);
+void disp_mono_round_hpages(lv_area_t * area);
+
+/* Pack color_map (the area, rounded as above) into bytes holding 8 vertical pixels,
+ * bit (y & 7) of dst[(y - y1) / 8 * width + (x - x1)]: SSD1306, PCD8544 and SH1107 in portrait */
+void disp_mono_pack_vpages(const lv_area_t * area, const lv_color_t * color_map, uint8_t * dst);
+
+/* Pack color_map into bytes holding 8 horizontal pixels,
+ * bit (x & 7) of dst[(x - x1) / 8 * height + (y - y1)]: SH1107 in landscape */
+void disp_mono_pack_hpages(const lv_area_t * area, const lv_color_t * color_map, uint8_t * dst);
+
+/* Round to whole bytes of the e-paper RAM after rotation: 8 columns for 0/180 degrees, 8 rows for 90/270 */
+void disp_mono_round_rows(lv_area_t * area, disp_mono_rot_t rot);
+
+/* Pack color_map (the area, rounded as above) into e-paper RAM: bytes of 8 horizontal pixels with the leftmost
+ * in the MSB and white pixels as set bits, rotated by "rot". Row y, byte b of the rotated frame is written to
+ * frame[y * row_stride + b * byte_stride]. The rotated area is returned in frame_area. For 90/180 degrees the
+ * screen's LV_VER_RES_MAX / LV_HOR_RES_MAX have to be multiples of 8. */
+void disp_mono_pack_rows(const lv_area_t * area, const lv_color_t * color_map, disp_mono_rot_t rot,
+    uint8_t * frame, uint16_t row_stride, uint16_t byte_stride, lv_area_t * frame_area);
+
+/* Like disp_mono_pack_rows() with 4 gray levels: bit 1 of a pixel's level (0 black .. 3 white) goes to
+ * plane_hi, bit 0 to plane_lo. The levels are taken from the brightness of the LVGL colors. */
+void disp_mono_pack_planes(const lv_area_t * area, const lv_color_t * color_map, disp_mono_rot_t rot,
+    uint8_t * plane_hi, uint8_t * plane_lo, uint16_t row_stride, uint16_t byte_stride, lv_area_t * frame_area);
+
+/* Send the bytes of pages page1..page2 that differ from the shadow, as runs of changed columns.
+ * "data" holds "width" bytes per page starting at "column". Everything is sent while the shadow
+ * is not valid yet. Returns the number of data bytes sent. */
+uint32_t disp_mono_shadow_send(disp_mono_shadow_t * shadow, uint8_t page1, uint8_t page2, uint16_t column,
+    uint16_t width, const uint8_t * data, disp_mono_send_cb_t send);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* DISP_MONO_H */
@@ -85,6 +85,7 @@
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static void IRAM_ATTR spi_pre (spi_transaction_t *trans);
 static void IRAM_ATTR spi_ready (spi_transaction_t *trans);
 
 /**********************
@@ -93,6 +94,7 @@ static void IRAM_ATTR spi_ready (spi_transaction_t *trans);
 static spi_host_device_t spi_host;
 static spi_device_handle_t spi;
 static QueueHandle_t TransactionPool = NULL;
+static transaction_cb_t chained_pre_cb;
 static transaction_cb_t chained_post_cb;
 
 /**********************
@@ -105,6 +107,8 @@ static transaction_cb_t chained_post_cb;
 void disp_spi_add_device_config(spi_host_device_t host, spi_device_interface_config_t *devcfg)
 {
     spi_host=host;
+    chained_pre_cb=devcfg->pre_cb;
+    devcfg->pre_cb=spi_pre;
     chained_post_cb=devcfg->post_cb;
     devcfg->post_cb=spi_ready;
     esp_err_t ret=spi_bus_add_device(host, devcfg, &spi);
@@ -272,10 +276,15 @@ void disp_spi_transaction(const uint8_t *data, size_t length,
 
 
 void disp_wait_for_pending_transactions(void)
+{
+    disp_wait_for_pending_transactions_max(0);	/* service until the transaction reuse pool is full again */
+}
+
+void disp_wait_for_pending_transactions_max(size_t max_pending)
 {
     spi_transaction_t *presult;
 
-	while(uxQueueMessagesWaiting(TransactionPool) < SPI_TRANSACTION_POOL_SIZE) {	/* service until the transaction reuse pool is full again */
+	while((SPI_TRANSACTION_POOL_SIZE - uxQueueMessagesWaiting(TransactionPool)) > max_pending) {	/* transactions complete in the order they were queued */
         if (spi_device_get_trans_result(spi, &presult, 1) == ESP_OK) {
 			xQueueSend(TransactionPool, &presult, portMAX_DELAY);
         }
@@ -297,6 +306,24 @@ void disp_spi_release(void)
  *   STATIC FUNCTIONS
  **********************/
 
+/* commands and data can be queued back to back, the DC pin follows each transaction */
+static void IRAM_ATTR spi_pre(spi_transaction_t *trans)
+{
+#if defined (CONFIG_LV_DISP_PIN_DC)
+    disp_spi_send_flag_t flags = (disp_spi_send_flag_t) trans->user;
+
+    if (flags & DISP_SPI_DC_CMD) {
+        gpio_set_level(CONFIG_LV_DISP_PIN_DC, 0);
+    } else if (flags & DISP_SPI_DC_DATA) {
+        gpio_set_level(CONFIG_LV_DISP_PIN_DC, 1);
+    }
+#endif
+
+    if (chained_pre_cb) {
+        chained_pre_cb(trans);
+    }
+}
+
 static void IRAM_ATTR spi_ready(spi_transaction_t *trans)
 {
     disp_spi_send_flag_t flags = (disp_spi_send_flag_t) trans->user;
@@ -40,6 +40,8 @@ typedef enum _disp_spi_send_flag_t {
     DISP_SPI_MODE_QIO           = 0x00000800, 
     DISP_SPI_MODE_DIOQIO_ADDR   = 0x00001000, 
 	DISP_SPI_VARIABLE_DUMMY		= 0x00002000,
+    DISP_SPI_DC_CMD             = 0x00004000, /* drive the DC pin low when the transaction starts */
+    DISP_SPI_DC_DATA            = 0x00008000, /* drive the DC pin high when the transaction starts */
 } disp_spi_send_flag_t;
 
 
@@ -61,6 +63,8 @@ void disp_spi_transaction(const uint8_t *data, size_t length,
     disp_spi_send_flag_t flags, uint8_t *out, uint64_t addr, uint8_t dummy_bits);
 
 void disp_wait_for_pending_transactions(void);
+/* wait until no more than "max_pending" queued transactions are still in flight, the oldest ones are done first */
+void disp_wait_for_pending_transactions_max(size_t max_pending);
 void disp_spi_acquire(void);
 void disp_spi_release(void);
 
@@ -0,0 +1,142 @@
+/**
+ * @file epd_policy.c
+ *
+ * Every partial refresh leaves a little ghosting behind in the pixels it drives. Instead of a full
+ * refresh every N updates, the screen is split into tiles that count the partial refreshes they
+ * took part in, and a full refresh is only done once one of them used up its budget, once the
+ * partially refreshed area adds up to a few screens, or after too long without a full refresh.
+ *
+ * In fast mode the drivers use short black/white waveforms and the budgets are ignored, so
+ * scrolling or animations are never interrupted by a full refresh. Leaving fast mode redraws the
+ * screen with a full refresh to clean up the ghosting that built up meanwhile.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+
+#include "epd_policy.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define TAG "epd_policy"
+
+#define TILE_SHIFT      5       /* 32x32 pixel tiles */
+
+/* The drivers pass areas in the frame of the panel, which is LVGL's screen turned by 90 degrees in
+ * some orientations. A square grid over the longer side covers both. */
+#define FRAME_SIDE_MAX  (LV_HOR_RES_MAX > LV_VER_RES_MAX ? LV_HOR_RES_MAX : LV_VER_RES_MAX)
+#define TILES           ((FRAME_SIDE_MAX + (1 << TILE_SHIFT) - 1) >> TILE_SHIFT)
+
+#define SCREEN_AREA     ((uint32_t) LV_HOR_RES_MAX * LV_VER_RES_MAX)
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static uint8_t tile_cnt[TILES][TILES];      /* partial refreshes since the last full one */
+static uint32_t partial_area = 0;           /* pixels refreshed partially since the last full one */
+static TickType_t last_full;
+static volatile bool force_full = true;     /* what the panel shows is unknown at start-up */
+static volatile bool fast = false;
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static uint8_t tile_index(lv_coord_t c)
+{
+    if (c < 0) {
+        return 0;
+    }
+    return ((c >> TILE_SHIFT) < TILES) ? (c >> TILE_SHIFT) : TILES - 1;
+}
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+bool epd_policy_update(const lv_area_t * area)
+{
+    bool full = force_full;
+    const char * reason = "forced";
+
+    if (!full && fast) {
+        /* count on the cleanup refresh when fast mode ends */
+        return false;
+    }
+
+    if (!full && CONFIG_LV_EPD_FULL_INTERVAL > 0 && partial_area > 0 &&
+        (xTaskGetTickCount() - last_full) >= pdMS_TO_TICKS(CONFIG_LV_EPD_FULL_INTERVAL * 1000UL)) {
+        full = true;
+        reason = "interval";
+    }
+
+    if (!full && CONFIG_LV_EPD_PARTIAL_AREA_MAX > 0 &&
+        partial_area + lv_area_get_size(area) > CONFIG_LV_EPD_PARTIAL_AREA_MAX * SCREEN_AREA) {
+        full = true;
+        reason = "area";
+    }
+
+    uint8_t tx1 = tile_index(area->x1);
+    uint8_t tx2 = tile_index(area->x2);
+    uint8_t ty1 = tile_index(area->y1);
+    uint8_t ty2 = tile_index(area->y2);
+
+    /* a tile that reached its budget would get one partial refresh too many */
+    for (uint8_t ty = ty1; !full && ty <= ty2; ty++) {
+        for (uint8_t tx = tx1; tx <= tx2; tx++) {
+            if (tile_cnt[ty][tx] >= CONFIG_LV_EPD_PARTIAL_MAX) {
+                full = true;
+                reason = "ghosting";
+                break;
+            }
+        }
+    }
+
+    if (full) {
+        ESP_LOGD(TAG, "Full refresh (%s) after %u partially refreshed pixels", reason, (unsigned) partial_area);
+        memset(tile_cnt, 0, sizeof(tile_cnt));
+        partial_area = 0;
+        last_full = xTaskGetTickCount();
+        force_full = false;
+        return true;
+    }
+
+    for (uint8_t ty = ty1; ty <= ty2; ty++) {
+        for (uint8_t tx = tx1; tx <= tx2; tx++) {
+            tile_cnt[ty][tx]++;
+        }
+    }
+    partial_area += lv_area_get_size(area);
+
+    return false;
+}
+
+void epd_policy_force_full(void)
+{
+    force_full = true;
+}
+
+void epd_policy_set_fast(bool enable)
+{
+    if (fast == enable) {
+        return;
+    }
+
+    ESP_LOGD(TAG, "Fast mode %s", enable ? "on" : "off");
+    fast = enable;
+
+    if (!enable) {
+        epd_policy_force_full();
+        lv_obj_invalidate(lv_scr_act());
+    }
+}
+
+bool epd_policy_is_fast(void)
+{
+    return fast;
+}
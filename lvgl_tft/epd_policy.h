@@ -0,0 +1,48 @@
+/**
+ * @file epd_policy.h
+ *
+ * Choice between partial and full refreshes for the e-paper drivers (IL3820, JD79653A, UC8151D).
+ */
+
+#ifndef EPD_POLICY_H
+#define EPD_POLICY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdbool.h>
+
+#ifdef LV_LVGL_H_INCLUDE_SIMPLE
+#include "lvgl.h"
+#else
+#include "lvgl/lvgl.h"
+#endif
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/* Called by the drivers before refreshing "area": returns true when it has to be a full refresh
+ * and books the refresh against the ghosting budget either way. */
+bool epd_policy_update(const lv_area_t * area);
+
+/* Make the next refresh a full one, e.g. after a screen change or when the controller lost its RAM */
+void epd_policy_force_full(void);
+
+/* Switch JD79653A and UC8151D to short black/white waveforms (well below 300 ms on the GDEW0154 panels)
+ * without full refreshes in between, e.g. while scrolling or animating. Switching back redraws the
+ * active screen with a full refresh. Call from the LVGL task. */
+void epd_policy_set_fast(bool enable);
+
+/* Called by the drivers to pick the partial waveform */
+bool epd_policy_is_fast(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* EPD_POLICY_H */
@@ -0,0 +1,281 @@
+/**
+ * @file epd_refresh.c
+ *
+ * E-paper waveforms take hundreds of milliseconds to seconds. The flush callbacks only copy the
+ * rendered area into the driver's frame and hand the buffer back to LVGL, a task sends the dirty
+ * part of the frame and waits for BUSY. Whatever LVGL flushes while a waveform runs is merged into
+ * the bounding box of the next update, so a burst of changes costs one refresh instead of one per
+ * area, and the panel never lags more than one waveform (plus EPD_REFRESH_MAX_DELAY_MS) behind.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <freertos/event_groups.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "epd_refresh.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#define TAG "epd_refresh"
+
+#define EPD_REFRESH_TASK_STACK  2048
+#define EPD_REFRESH_TASK_PRIO   5
+
+/* task notification bits */
+#define NOTIFY_DIRTY            (1UL << 0UL)    /* the frame got dirty */
+#define NOTIFY_LAST             (1UL << 1UL)    /* LVGL flushed the last area of a refresh cycle */
+
+/* event group bits */
+#define EVT_IDLE                (1UL << 0UL)    /* nothing dirty and no waveform running */
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void epd_refresh_task(void * arg);
+static bool epd_refresh_take_dirty(lv_area_t * area);
+static void epd_refresh_account(const lv_area_t * area, int64_t start_us);
+static void epd_refresh_add(epd_refresh_stats_t * s, uint32_t ms);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static TaskHandle_t refresh_task = NULL;
+static SemaphoreHandle_t frame_mutex = NULL;
+static EventGroupHandle_t refresh_evts = NULL;
+static epd_refresh_upload_cb_t upload_cb;
+static epd_refresh_idle_cb_t idle_cb = NULL;
+static uint32_t idle_delay_ms;
+
+static lv_area_t dirty;
+static bool dirty_valid = false;
+
+static epd_refresh_stats_t stats;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+bool epd_refresh_init(epd_refresh_upload_cb_t upload)
+{
+    upload_cb = upload;
+
+    if (refresh_task != NULL) {
+        return true;
+    }
+
+    frame_mutex = xSemaphoreCreateMutex();
+    refresh_evts = xEventGroupCreate();
+    if (frame_mutex == NULL || refresh_evts == NULL) {
+        ESP_LOGE(TAG, "Out of memory, refreshing in the flush callback");
+        return false;
+    }
+    xEventGroupSetBits(refresh_evts, EVT_IDLE);
+
+    if (xTaskCreate(epd_refresh_task, TAG, EPD_REFRESH_TASK_STACK, NULL, EPD_REFRESH_TASK_PRIO, &refresh_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create task, refreshing in the flush callback");
+        refresh_task = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void epd_refresh_set_idle(epd_refresh_idle_cb_t idle, uint32_t delay_ms)
+{
+    idle_cb = idle;
+    idle_delay_ms = delay_ms;
+}
+
+void epd_refresh_lock(void)
+{
+    if (frame_mutex != NULL) {
+        xSemaphoreTake(frame_mutex, portMAX_DELAY);
+    }
+}
+
+void epd_refresh_unlock(void)
+{
+    if (frame_mutex != NULL) {
+        xSemaphoreGive(frame_mutex);
+    }
+}
+
+void epd_refresh_mark(lv_disp_drv_t * drv, const lv_area_t * area)
+{
+    bool last = lv_disp_flush_is_last(drv);
+
+    if (refresh_task == NULL) {
+        /* no task, refresh every area right here */
+        int64_t start_us = esp_timer_get_time();
+        epd_refresh_lock();
+        epd_refresh_finish_cb_t finish = upload_cb(area);
+        epd_refresh_unlock();
+        finish();
+        epd_refresh_account(area, start_us);
+        lv_disp_flush_ready(drv);
+        return;
+    }
+
+    epd_refresh_lock();
+    bool was_dirty = dirty_valid;
+    if (dirty_valid) {
+        _lv_area_join(&dirty, &dirty, area);
+    } else {
+        lv_area_copy(&dirty, area);
+        dirty_valid = true;
+        xEventGroupClearBits(refresh_evts, EVT_IDLE);
+    }
+    epd_refresh_unlock();
+
+    if (!was_dirty || last) {
+        xTaskNotify(refresh_task, (was_dirty ? 0 : NOTIFY_DIRTY) | (last ? NOTIFY_LAST : 0), eSetBits);
+    }
+
+    lv_disp_flush_ready(drv);
+}
+
+void epd_refresh_wait(void)
+{
+    if (refresh_evts != NULL) {
+        xEventGroupWaitBits(refresh_evts, EVT_IDLE, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+}
+
+void epd_refresh_get_stats(epd_refresh_stats_t * out)
+{
+    epd_refresh_lock();
+    *out = stats;
+    epd_refresh_unlock();
+}
+
+void epd_refresh_benchmark(const epd_refresh_upload_cb_t uploads[EPD_BENCH_COUNT], const lv_area_t * area,
+    uint8_t rounds, epd_refresh_stats_t results[EPD_BENCH_COUNT])
+{
+    static const char * const names[EPD_BENCH_COUNT] = { "full", "partial", "gray" };
+
+    memset(results, 0, EPD_BENCH_COUNT * sizeof(epd_refresh_stats_t));
+    epd_refresh_wait();
+
+    /* neither the refresh task nor the idle callback get in between until all rounds are done */
+    epd_refresh_lock();
+    for (uint8_t round = 0; round < rounds; round++) {
+        for (uint8_t mode = 0; mode < EPD_BENCH_COUNT; mode++) {
+            if (uploads[mode] == NULL) {
+                continue;
+            }
+
+            int64_t start_us = esp_timer_get_time();
+            epd_refresh_finish_cb_t finish = uploads[mode](area);
+            finish();
+            epd_refresh_add(&results[mode], (uint32_t) ((esp_timer_get_time() - start_us) / 1000));
+        }
+    }
+    epd_refresh_unlock();
+
+    for (uint8_t mode = 0; mode < EPD_BENCH_COUNT; mode++) {
+        if (results[mode].count > 0) {
+            ESP_LOGI(TAG, "%dx%d %s: %u refreshes, %u ms average, %u ms max",
+                lv_area_get_width(area), lv_area_get_height(area), names[mode], (unsigned) results[mode].count,
+                (unsigned) (results[mode].total_ms / results[mode].count), (unsigned) results[mode].max_ms);
+        }
+    }
+}
+
+void epd_refresh_copy_rows(uint8_t * frame, uint16_t row_len, const lv_area_t * area, const uint8_t * buf)
+{
+    uint16_t len = lv_area_get_width(area) / 8;
+    uint8_t * dst = frame + area->y1 * row_len + area->x1 / 8;
+
+    for (lv_coord_t y = area->y1; y <= area->y2; y++) {
+        memcpy(dst, buf, len);
+        dst += row_len;
+        buf += len;
+    }
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static void epd_refresh_task(void * arg)
+{
+    lv_area_t area;
+    uint32_t evt;
+    bool idle_due = false;
+
+    for (;;) {
+        if (idle_due && idle_cb != NULL) {
+            if (xTaskNotifyWait(0, UINT32_MAX, &evt, pdMS_TO_TICKS(idle_delay_ms)) != pdTRUE) {
+                idle_cb();
+                idle_due = false;
+                continue;
+            }
+        } else {
+            xTaskNotifyWait(0, UINT32_MAX, &evt, portMAX_DELAY);
+        }
+
+        /* LVGL is still flushing the areas of this cycle, give it a moment to finish */
+        if (!(evt & NOTIFY_LAST)) {
+            xTaskNotifyWait(0, UINT32_MAX, &evt, pdMS_TO_TICKS(EPD_REFRESH_MAX_DELAY_MS));
+        }
+
+        int64_t start_us = esp_timer_get_time();
+        epd_refresh_lock();
+        bool valid = epd_refresh_take_dirty(&area);
+        epd_refresh_finish_cb_t finish = valid ? upload_cb(&area) : NULL;
+        epd_refresh_unlock();
+
+        if (finish != NULL) {
+            finish();
+            epd_refresh_account(&area, start_us);
+            idle_due = true;
+        }
+
+        /* anything flushed meanwhile has notified us again */
+        epd_refresh_lock();
+        if (!dirty_valid) {
+            xEventGroupSetBits(refresh_evts, EVT_IDLE);
+        }
+        epd_refresh_unlock();
+    }
+}
+
+static void epd_refresh_account(const lv_area_t * area, int64_t start_us)
+{
+    uint32_t ms = (uint32_t) ((esp_timer_get_time() - start_us) / 1000);
+
+    epd_refresh_lock();
+    epd_refresh_add(&stats, ms);
+    epd_refresh_unlock();
+
+    ESP_LOGD(TAG, "Refresh of %dx%d took %u ms", lv_area_get_width(area), lv_area_get_height(area), (unsigned) ms);
+}
+
+static void epd_refresh_add(epd_refresh_stats_t * s, uint32_t ms)
+{
+    s->count++;
+    s->last_ms = ms;
+    s->total_ms += ms;
+    if (ms > s->max_ms) {
+        s->max_ms = ms;
+    }
+}
+
+/* Called with the frame locked */
+static bool epd_refresh_take_dirty(lv_area_t * area)
+{
+    if (!dirty_valid) {
+        return false;
+    }
+
+    lv_area_copy(area, &dirty);
+    dirty_valid = false;
+    return true;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file epd_refresh.h
+ *
+ * Update manager of the e-paper drivers (IL3820, JD79653A, UC8151D): refreshes run in the background
+ * and areas flushed by LVGL meanwhile are merged into one update.
+ */
+
+#ifndef EPD_REFRESH_H
+#define EPD_REFRESH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef LV_LVGL_H_INCLUDE_SIMPLE
+#include "lvgl.h"
+#else
+#include "lvgl/lvgl.h"
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* How long dirty areas wait for LVGL to finish its refresh cycle before they are sent anyway */
+#define EPD_REFRESH_MAX_DELAY_MS    200
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* Wait for the controller to release BUSY and send what follows the waveform (power off, partial out, ...) */
+typedef void (*epd_refresh_finish_cb_t)(void);
+
+/* Runs in the refresh task after a quiet period, e.g. to power the panel off */
+typedef void (*epd_refresh_idle_cb_t)(void);
+
+/* Refresh times measured by the refresh task, from sending the frame to the end of the waveform */
+typedef struct {
+    uint32_t count;
+    uint32_t last_ms;
+    uint32_t max_ms;
+    uint32_t total_ms;
+} epd_refresh_stats_t;
+
+/* Waveforms compared by the drivers' benchmark functions */
+enum {
+    EPD_BENCH_FULL,
+    EPD_BENCH_PARTIAL,
+    EPD_BENCH_GRAY,         /* 4-gray mode, only with CONFIG_LV_EPD_GRAY4 */
+    EPD_BENCH_COUNT,
+};
+
+/* Send "area" from the driver's frame copy and start the refresh, called with the frame locked.
+ * Returns what has to run once the waveform started. */
+typedef epd_refresh_finish_cb_t (*epd_refresh_upload_cb_t)(const lv_area_t * area);
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/* Create the refresh task, called from the driver's init */
+bool epd_refresh_init(epd_refresh_upload_cb_t upload);
+
+/* Call "idle" once no refresh was needed for "delay_ms" after the last one */
+void epd_refresh_set_idle(epd_refresh_idle_cb_t idle, uint32_t delay_ms);
+
+/* Lock the driver's frame copy while writing to it */
+void epd_refresh_lock(void);
+void epd_refresh_unlock(void);
+
+/* Called by the flush callback after "area" was copied into the frame. LVGL gets the buffer back
+ * right away; the refresh starts when LVGL has flushed the last area of its refresh cycle and
+ * the panel is idle, areas flushed during a running waveform join the next update. */
+void epd_refresh_mark(lv_disp_drv_t * drv, const lv_area_t * area);
+
+/* Block until the frame is on the panel, before talking to the panel outside of the flush callback */
+void epd_refresh_wait(void);
+
+/* Refresh times so far, e.g. to compare waveforms or the 4-gray mode with black and white */
+void epd_refresh_get_stats(epd_refresh_stats_t * stats);
+
+/* Refresh "area" "rounds" times with each of the uploads in turn (NULL ones are skipped) and time them from
+ * sending the frame to the end of the waveform. results[] is indexed like uploads[], the averages and maxima
+ * are logged as well. Blocks until all rounds are done, call from the LVGL task like the drivers' functions. */
+void epd_refresh_benchmark(const epd_refresh_upload_cb_t uploads[EPD_BENCH_COUNT], const lv_area_t * area,
+    uint8_t rounds, epd_refresh_stats_t results[EPD_BENCH_COUNT]);
+
+/* Copy a flushed area into a frame of "row_len" bytes per row, 8 horizontal pixels per byte (MSB first).
+ * The area has to start and end on a byte boundary. */
+void epd_refresh_copy_rows(uint8_t * frame, uint16_t row_len, const lv_area_t * area, const uint8_t * buf);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* EPD_REFRESH_H */
@@ -28,11 +28,17 @@ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR TH
 /*********************
  *      INCLUDES
  *********************/
+#include <string.h>
+
 #include "disp_spi.h"
+#include "disp_mono.h"
+#include "epd_refresh.h"
+#include "epd_policy.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/event_groups.h"
 
 #include "il3820.h"
 
@@ -64,6 +70,9 @@ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR TH
 
 #define IL3820_PIXELS_PER_BYTE		8
 
+/* Set by the BUSY interrupt when the controller is done */
+#define IL3820_EVT_IDLE                 (1UL << 0UL)
+
 uint8_t il3820_scan_mode = IL3820_DATA_ENTRY_XIYIY;
 
 static uint8_t il3820_lut_initial[] = {
@@ -90,8 +99,25 @@ static uint8_t il3820_border[] = {0x03};
 
 static bool il3820_partial = false;
 
+static EventGroupHandle_t il3820_evts = NULL;
+
+/* Copy of the frame LVGL rendered, sent by the epd_refresh task.
+ * Arrays used by SPI must be word alligned */
+static WORD_ALIGNED_ATTR uint8_t il3820_frame[IL3820_COLUMNS * EPD_PANEL_HEIGHT];
+
+/* Without set_px_cb LVGL renders one lv_color_t per pixel and the flush packs it
+ * into il3820_frame in RAM order: the entry mode fills a column of bytes (Y first)
+ * before moving to the next one. Portrait is the panel turned upside down. */
+static bool il3820_native = false;
+#if defined (CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT)
+#define IL3820_ROT  DISP_MONO_ROT_180
+#else
+#define IL3820_ROT  DISP_MONO_ROT_0
+#endif
+
 /* Static functions */
 static void il3820_clear_cntlr_mem(uint8_t ram_cmd, bool update);
+static void il3820_busy_intr(void *arg);
 static void il3820_waitbusy(int wait_ms);
 static inline void il3820_command_mode(void);
 static inline void il3820_data_mode(void);
@@ -100,20 +126,53 @@ static inline void il3820_send_cmd(uint8_t cmd);
 static void il3820_send_data(uint8_t *data, uint16_t length);
 static inline void il3820_set_window( uint16_t sx, uint16_t ex, uint16_t ys, uint16_t ye);
 static inline void il3820_set_cursor(uint16_t sx, uint16_t ys);
+static void il3820_start_update(void);
+static void il3820_finish_update(void);
 static void il3820_update_display(void);
 static void il3820_clear_cntlr_mem(uint8_t ram_cmd, bool update);
 
 /* Required by LVGL */
 void il3820_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
 {
-    /* Each byte holds the data of 8 pixels, linelen is the number of bytes
-     * we need to cover a line of the display. */
-    size_t linelen = EPD_PANEL_WIDTH / 8;
+    lv_area_t frame_area;
+
+    /* Keep the frame until the panel is idle and let epd_refresh merge it
+     * with whatever LVGL flushes meanwhile. */
+    epd_refresh_lock();
+    il3820_native = disp_mono_native(drv);
+    if (il3820_native) {
+        disp_mono_pack_rows(area, color_map, IL3820_ROT, il3820_frame, 1, EPD_PANEL_HEIGHT, &frame_area);
+    } else {
+        /* set_px_cb already drew into a buffer holding the whole frame */
+        memcpy(il3820_frame, color_map, sizeof il3820_frame);
+        lv_area_copy(&frame_area, area);
+    }
+    epd_refresh_unlock();
+
+    /* IMPORTANT!!!
+     * Inform the graphics library that you are ready with the flushing,
+     * done by epd_refresh_mark() */
+    epd_refresh_mark(drv, &frame_area);
+}
 
-    uint8_t *buffer = (uint8_t*) color_map;
+/* Runs in the epd_refresh task with the frame locked */
+static epd_refresh_finish_cb_t il3820_upload(const lv_area_t *area)
+{
+    uint8_t *buffer = il3820_frame;
     uint16_t x_addr_counter = 0;
     uint16_t y_addr_counter = 0;
 
+    /* The whole frame is sent either way, the policy picks the waveform */
+    bool full = epd_policy_update(area);
+    if (full == il3820_partial) {
+        il3820_partial = !full;
+        if (full) {
+            il3820_write_cmd(IL3820_CMD_UPDATE_LUT, il3820_lut_initial, sizeof(il3820_lut_initial));
+        } else {
+            il3820_write_cmd(IL3820_CMD_UPDATE_LUT, il3820_lut_default, sizeof(il3820_lut_default));
+        }
+    }
+
     /* Configure entry mode  */
     il3820_write_cmd(IL3820_CMD_ENTRY_MODE, &il3820_scan_mode, 1);
 
@@ -124,27 +183,25 @@ void il3820_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_m
 
     /* Set the cursor at the beginning of the graphic RAM */
 #if defined (CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT)
-    x_addr_counter = EPD_PANEL_WIDTH - 1;
-    y_addr_counter = EPD_PANEL_HEIGHT - 1;
+    if (!il3820_native) {
+        x_addr_counter = EPD_PANEL_WIDTH - 1;
+        y_addr_counter = EPD_PANEL_HEIGHT - 1;
+    }
 #endif
 
     il3820_set_cursor(x_addr_counter, y_addr_counter);
 
     il3820_send_cmd(IL3820_CMD_WRITE_RAM);
 
-    /* Write the pixel data to graphic RAM, linelen bytes at the time. */
-    for(size_t row = 0; row <= (EPD_PANEL_HEIGHT - 1); row++){
-	il3820_send_data(buffer, linelen);
-	buffer += IL3820_COLUMNS;
-    }
+    /* Write the pixel data to graphic RAM in one go, the address counter
+     * wraps at the end of the window by itself. */
+    il3820_send_data(buffer, sizeof il3820_frame);
 
     il3820_set_window(0, EPD_PANEL_WIDTH - 1, 0, EPD_PANEL_HEIGHT - 1);
 
-    il3820_update_display();
+    il3820_start_update();
 
-    /* IMPORTANT!!!
-     * Inform the graphics library that you are ready with the flushing */
-    lv_disp_flush_ready(drv);
+    return il3820_finish_update;
 }
 
 
@@ -184,7 +241,7 @@ void il3820_set_px_cb(lv_disp_drv_t * disp_drv, uint8_t* buf,
 #endif
 }
 
-/* Required by LVGL */
+/* Required by LVGL, whole bytes of 8 columns in either mode */
 void il3820_rounder(lv_disp_drv_t * disp_drv, lv_area_t *area) {
     area->x1 = area->x1 & ~(0x7);
     area->x2 = area->x2 |  (0x7);
@@ -199,8 +256,24 @@ void il3820_init(void)
     gpio_pad_select_gpio(IL3820_DC_PIN);
     gpio_set_direction(IL3820_DC_PIN, GPIO_MODE_OUTPUT);
 
-    gpio_pad_select_gpio(IL3820_BUSY_PIN);
-    gpio_set_direction(IL3820_BUSY_PIN,  GPIO_MODE_INPUT);
+    /* BUSY goes low when the controller is done, wake up on that edge
+     * instead of polling */
+    il3820_evts = xEventGroupCreate();
+    if (il3820_evts == NULL) {
+        ESP_LOGE(TAG, "Failed when initialising event group!");
+        return;
+    }
+
+    gpio_config_t busy_io_conf = {
+        .intr_type = GPIO_INTR_NEGEDGE,
+        .mode = GPIO_MODE_INPUT,
+        .pin_bit_mask = (1ULL << IL3820_BUSY_PIN),
+        .pull_down_en = 0,
+        .pull_up_en = 0,
+    };
+    ESP_ERROR_CHECK(gpio_config(&busy_io_conf));
+    gpio_install_isr_service(0);
+    gpio_isr_handler_add(IL3820_BUSY_PIN, il3820_busy_intr, NULL);
 
 #if IL3820_USE_RST
     gpio_pad_select_gpio(IL3820_RST_PIN);
@@ -249,6 +322,9 @@ void il3820_init(void)
 
     /* Clear control memory and update */
     il3820_clear_cntlr_mem(IL3820_CMD_WRITE_RAM, true);
+
+    /* Refresh in the background instead of the flush callback */
+    epd_refresh_init(il3820_upload);
 }
 
 /* Enter deep sleep mode */
@@ -256,28 +332,38 @@ void il3820_sleep_in(void)
 {
     uint8_t data[] = {0x01};
 
-    /* Wait for the BUSY signal to go low */
+    /* Let a running refresh finish and wait for the BUSY signal to go low */
+    epd_refresh_wait();
     il3820_waitbusy(IL3820_WAIT);
 
     il3820_write_cmd(IL3820_CMD_SLEEP_MODE, data, 1);
 }
 
-/* TODO: Remove the busy waiting */
-static void il3820_waitbusy(int wait_ms)
+static void IRAM_ATTR il3820_busy_intr(void *arg)
 {
-    int i = 0;
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
-    vTaskDelay(10 / portTICK_RATE_MS); // 10ms delay
+    if (xEventGroupSetBitsFromISR(il3820_evts, IL3820_EVT_IDLE, &xHigherPriorityTaskWoken) == pdPASS) {
+        portYIELD_FROM_ISR();
+    }
+}
 
-    for(i = 0; i < (wait_ms * 10); i++) {
-	if(gpio_get_level(IL3820_BUSY_PIN) != IL3820_BUSY_LEVEL) {
-            return;
-        }
+/* Wait for the BUSY signal to go low, for up to wait_ms */
+static void il3820_waitbusy(int wait_ms)
+{
+    /* The controller raises BUSY as soon as it got the command, make sure it's out */
+    disp_wait_for_pending_transactions();
 
-        vTaskDelay(10 / portTICK_RATE_MS);
+    /* Forget edges of earlier commands, then only sleep if BUSY is still high */
+    xEventGroupClearBits(il3820_evts, IL3820_EVT_IDLE);
+    if (gpio_get_level(IL3820_BUSY_PIN) != IL3820_BUSY_LEVEL) {
+        return;
     }
 
-    ESP_LOGE( TAG, "busy exceeded %dms", i*10 );
+    EventBits_t bits = xEventGroupWaitBits(il3820_evts, IL3820_EVT_IDLE, pdTRUE, pdTRUE, pdMS_TO_TICKS(wait_ms));
+    if ((bits & IL3820_EVT_IDLE) == 0 && gpio_get_level(IL3820_BUSY_PIN) == IL3820_BUSY_LEVEL) {
+        ESP_LOGE( TAG, "busy exceeded %dms", wait_ms );
+    }
 }
 
 /* Set DC signal to command mode */
@@ -314,13 +400,14 @@ static inline void il3820_send_cmd(uint8_t cmd)
     disp_spi_send_data(&cmd, 1);
 }
 
-/* Send length bytes of data to the display */
+/* Send length bytes of data to the display. This runs in the epd_refresh task after LVGL got its
+ * buffer back, so the transfer is queued without DISP_SPI_SIGNAL_FLUSH; the next command waits for it. */
 static void il3820_send_data(uint8_t *data, uint16_t length)
 {
     disp_wait_for_pending_transactions();
 
     il3820_data_mode();
-    disp_spi_send_colors(data, length);
+    disp_spi_transaction(data, length, DISP_SPI_SEND_QUEUED, NULL, 0, 0);
 }
 
 /* Specify the start/end positions of the window address in the X and Y
@@ -369,11 +456,8 @@ static inline void il3820_set_cursor(uint16_t sx, uint16_t ys)
 
 /* After sending the RAM content we need to send the commands:
  * - Display Update Control 2
- * - Master Activation
- *
- * NOTE: Currently we poll for the BUSY signal to go inactive,
- * we might want not to do it. */
-static void il3820_update_display(void)
+ * - Master Activation */
+static void il3820_start_update(void)
 {
     uint8_t tmp = 0;
 
@@ -386,18 +470,27 @@ static void il3820_update_display(void)
     il3820_write_cmd(IL3820_CMD_UPDATE_CTRL2, &tmp, 1);
 
     il3820_write_cmd(IL3820_CMD_MASTER_ACTIVATION, NULL, 0);
+}
+
+/* Runs in the background after a flush, see epd_refresh.h */
+static void il3820_finish_update(void)
+{
     /* Poll BUSY signal. */
     il3820_waitbusy(IL3820_WAIT);
     /* XXX: Figure out what does this command do. */
     il3820_write_cmd(IL3820_CMD_TERMINATE_FRAME_RW, NULL, 0);
 }
 
-/* Clear the graphic RAM. */
+static void il3820_update_display(void)
+{
+    il3820_start_update();
+    il3820_finish_update();
+}
+
+/* Clear the graphic RAM, and the frame copy with it. */
 static void il3820_clear_cntlr_mem(uint8_t ram_cmd, bool update)
 {
-    /* Arrays used by SPI must be word alligned */
-    WORD_ALIGNED_ATTR uint8_t clear_page[IL3820_COLUMNS];
-    memset(clear_page, 0xff, sizeof clear_page);
+    memset(il3820_frame, 0xff, sizeof il3820_frame);
 
     /* Configure entry mode */
     il3820_write_cmd(IL3820_CMD_ENTRY_MODE, &il3820_scan_mode, 1);
@@ -405,11 +498,13 @@ static void il3820_clear_cntlr_mem(uint8_t ram_cmd, bool update)
     /* Configure the window */
     il3820_set_window(0, EPD_PANEL_WIDTH - 1, 0, EPD_PANEL_HEIGHT - 1);
 
-    /* Send clear_page buffer to the display */
-    for(int j = 0; j < EPD_PANEL_HEIGHT; j++) {
-	il3820_set_cursor(0, j);
-	il3820_write_cmd(ram_cmd, clear_page, sizeof clear_page);
-    }
+    /* One command and one stream of white for the whole window. This also runs from il3820_init()
+     * before LVGL refreshes anything, so the stream must not signal a flush; wait until it's out. */
+    il3820_set_cursor(0, 0);
+    il3820_send_cmd(ram_cmd);
+    il3820_data_mode();
+    disp_spi_send_data(il3820_frame, sizeof il3820_frame);
+    disp_wait_for_pending_transactions();
 
     if (update) {
 	il3820_set_window( 0, EPD_PANEL_WIDTH - 1, 0, EPD_PANEL_HEIGHT - 1);
@@ -95,8 +95,8 @@ extern "C"
 /* time constants in ms */
 #define IL3820_RESET_DELAY			20
 #define IL3820_BUSY_DELAY			1
-// normal wait time max 200ms
-#define IL3820_WAIT                20
+// BUSY timeout, a full refresh takes up to about 2s
+#define IL3820_WAIT                2000
 
 void il3820_init(void);
 void il3820_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map);
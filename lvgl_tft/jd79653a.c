@@ -25,6 +25,8 @@ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR TH
 
 */
 
+#include <string.h>
+
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/event_groups.h>
@@ -32,6 +34,9 @@ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR TH
 #include <esp_log.h>
 
 #include "disp_spi.h"
+#include "disp_mono.h"
+#include "epd_refresh.h"
+#include "epd_policy.h"
 #include "jd79653a.h"
 
 #define TAG "lv_jd79653a"
@@ -43,15 +48,49 @@ TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR TH
 #define PIN_BUSY            CONFIG_LV_DISP_PIN_BUSY
 #define PIN_BUSY_BIT        ((1ULL << (uint8_t)(CONFIG_LV_DISP_PIN_BUSY)))
 #define EVT_BUSY            (1UL << 0UL)
+#define EPD_POWER_OFF_MS    1000    // Keep the charge pump on this long after the last fast update
+
+// Landscape keeps the panel in portrait and rotates LVGL's buffer while packing it into the frame,
+// this needs LVGL to render natively (no set_px_cb)
+#if defined (CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE)
+#define EPD_ROT             DISP_MONO_ROT_90
+#elif defined (CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE_INVERTED)
+#define EPD_ROT             DISP_MONO_ROT_270
+#else
+#define EPD_ROT             DISP_MONO_ROT_0
+#endif
+
+#if defined (CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE) || defined (CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE_INVERTED)
+#define EPD_WIDTH           LV_VER_RES_MAX
+#define EPD_HEIGHT          LV_HOR_RES_MAX
+#else
 #define EPD_WIDTH           LV_HOR_RES_MAX
 #define EPD_HEIGHT          LV_VER_RES_MAX
-#define EPD_ROW_LEN         (EPD_HEIGHT / 8u)
-#define EPD_PARTIAL_CNT     5;
+#endif
+#define EPD_ROW_LEN         (EPD_WIDTH / 8u)
 
 #define BIT_SET(a, b)       ((a) |= (1U << (b)))
 #define BIT_CLEAR(a, b)     ((a) &= ~(1U << (b)))
 
-static uint8_t partial_counter = 0;
+// What the panel shows (or is about to), partial windows are sent from here
+static uint8_t frame[EPD_ROW_LEN * EPD_HEIGHT];
+
+// What the panel shows, the controller's OLD RAM holds the same between refreshes so that
+// an update only has to send the NEW data of its window
+static uint8_t shown[EPD_ROW_LEN * EPD_HEIGHT];
+static bool ram_valid = false;      // OLD/NEW RAM match "shown", lost by reset and deep sleep
+static lv_area_t sent_area;         // Window of the running refresh, copied to OLD RAM afterwards
+static bool powered = false;        // Charge pump on
+static bool partial_mode = false;   // Register LUTs loaded, partial window active
+static bool partial_fast = false;   // The loaded LUTs are the fast ones
+
+static const lv_area_t full_area = { 0, 0, EPD_WIDTH - 1, EPD_HEIGHT - 1 };
+
+#if defined (CONFIG_LV_EPD_GRAY4)
+// 4-gray mode: bit 1 of the gray level goes to OLD RAM from here, bit 0 to NEW RAM from "frame",
+// the LUT of each OLD/NEW pair drives the pixel to its level
+static uint8_t frame_hi[EPD_ROW_LEN * EPD_HEIGHT];
+#endif
 
 typedef struct
 {
@@ -120,13 +159,81 @@ static const uint8_t lut_bb1[] = {
 };
 
 
+// Fast LUTs: one short drive of the changed pixels without the balancing phases of the partial LUTs,
+// used while epd_policy_set_fast() is on. Ghosting builds up until fast mode ends with a full refresh.
+static const uint8_t lut_vcom_fast[56] = {
+    0x01, 0x05, 0x00, 0x00, 0x01, 0x01, 0x01,
+};
+
+static const uint8_t lut_ww_fast[42] = {
+    0x01, 0x05, 0x00, 0x00, 0x01, 0x01, 0x01,
+};
+
+static const uint8_t lut_bw_fast[56] = {
+    0x01, 0x85, 0x00, 0x00, 0x01, 0x01, 0x01,
+};
+
+static const uint8_t lut_wb_fast[56] = {
+    0x01, 0x45, 0x00, 0x00, 0x01, 0x01, 0x01,
+};
+
+static const uint8_t lut_bb_fast[56] = {
+    0x01, 0x05, 0x00, 0x00, 0x01, 0x01, 0x01,
+};
+
+#if defined (CONFIG_LV_EPD_GRAY4)
+// 4-gray LUTs: clean the window to white, then darken for 0, 2, 5 or 10 frames.
+// OLD/NEW pairs: WW white, WB light gray, BW dark gray, BB black
+static const uint8_t lut_vcom_gray[56] = {
+    0x01, 0x0a, 0x0a, 0x00, 0x00, 0x01, 0x01,
+    0x01, 0x02, 0x03, 0x05, 0x00, 0x01, 0x01,
+};
+
+static const uint8_t lut_ww_gray[42] = {
+    0x01, 0x4a, 0x8a, 0x00, 0x00, 0x01, 0x01,
+    0x01, 0x02, 0x03, 0x05, 0x00, 0x01, 0x01,
+};
+
+static const uint8_t lut_bw_gray[56] = {
+    0x01, 0x4a, 0x8a, 0x00, 0x00, 0x01, 0x01,
+    0x01, 0x42, 0x43, 0x05, 0x00, 0x01, 0x01,
+};
+
+static const uint8_t lut_wb_gray[56] = {
+    0x01, 0x4a, 0x8a, 0x00, 0x00, 0x01, 0x01,
+    0x01, 0x42, 0x03, 0x05, 0x00, 0x01, 0x01,
+};
+
+static const uint8_t lut_bb_gray[56] = {
+    0x01, 0x4a, 0x8a, 0x00, 0x00, 0x01, 0x01,
+    0x01, 0x42, 0x43, 0x45, 0x00, 0x01, 0x01,
+};
+#endif
+
+// One set of register LUTs: VCOM, White-to-White, Black-to-White, White-to-Black, Black-to-Black
+typedef struct
+{
+    const uint8_t *lut[5];
+    size_t len[5];
+} jd79653a_lut_set_t;
+
+#define LUT_SET(vcom, ww, bw, wb, bb) \
+    { { vcom, ww, bw, wb, bb }, { sizeof(vcom), sizeof(ww), sizeof(bw), sizeof(wb), sizeof(bb) } }
+
+static const jd79653a_lut_set_t lut_partial = LUT_SET(lut_vcom_dc1, lut_ww1, lut_bw1, lut_wb1, lut_bb1);
+static const jd79653a_lut_set_t lut_fast = LUT_SET(lut_vcom_fast, lut_ww_fast, lut_bw_fast, lut_wb_fast, lut_bb_fast);
+#if defined (CONFIG_LV_EPD_GRAY4)
+static const jd79653a_lut_set_t lut_gray = LUT_SET(lut_vcom_gray, lut_ww_gray, lut_bw_gray, lut_wb_gray, lut_bb_gray);
+#endif
+
 static const jd79653a_seq_t init_seq[] = {
 #if defined (CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT_INVERTED)
         {0x00, {0xd3, 0x0e},       2},                 // Panel settings
-#elif defined(CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT)
+#elif defined(CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT) || defined(CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE) || \
+      defined(CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE_INVERTED)
         {0x00, {0xdf, 0x0e}, 2},                 // Panel settings
 #else
-#error "Unsupported orientation - only portrait modes are supported for now"
+#error "Unsupported orientation"
 #endif
         {0x4d, {0x55}, 1},                             // Undocumented secret from demo code
         {0xaa, {0x0f}, 1},                             // Undocumented secret from demo code
@@ -209,9 +316,14 @@ static esp_err_t jd79653a_wait_busy(uint32_t timeout_ms)
 
 static void jd79653a_power_on()
 {
+    if (powered) {
+        return;
+    }
+
     jd79653a_spi_send_seq(power_on_seq, EPD_SEQ_LEN(power_on_seq));
     vTaskDelay(pdMS_TO_TICKS(10));
     jd79653a_wait_busy(0);
+    powered = true;
 }
 
 static void jd79653a_power_off()
@@ -219,40 +331,37 @@ static void jd79653a_power_off()
     jd79653a_spi_send_seq(power_off_seq, EPD_SEQ_LEN(power_off_seq));
     vTaskDelay(pdMS_TO_TICKS(10));
     jd79653a_wait_busy(0);
+    powered = false;
 }
 
-static void jd79653a_load_partial_lut()
+static void jd79653a_load_lut(const jd79653a_lut_set_t *set)
 {
-    jd79653a_spi_send_cmd(0x20); // LUT VCOM register
-    jd79653a_spi_send_data((uint8_t *)lut_vcom_dc1, sizeof(lut_vcom_dc1));
-
-    jd79653a_spi_send_cmd(0x21); // LUT White-to-White
-    jd79653a_spi_send_data((uint8_t *)lut_ww1, sizeof(lut_ww1));
-
-    jd79653a_spi_send_cmd(0x22); // LUT Black-to-White
-    jd79653a_spi_send_data((uint8_t *)lut_bw1, sizeof(lut_bw1));
-
-    jd79653a_spi_send_cmd(0x23); // LUT White-to-Black
-    jd79653a_spi_send_data((uint8_t *)lut_wb1,sizeof(lut_wb1));
-
-    jd79653a_spi_send_cmd(0x24); // LUT Black-to-Black
-    jd79653a_spi_send_data((uint8_t *)lut_bb1, sizeof(lut_bb1));
+    for (uint8_t idx = 0; idx < 5; idx++) {
+        jd79653a_spi_send_cmd(0x20 + idx); // LUT VCOM, WW, BW, WB, BB registers
+        jd79653a_spi_send_data((uint8_t *) set->lut[idx], set->len[idx]);
+    }
 }
 
-static void jd79653a_partial_in()
+static void jd79653a_use_reg_lut()
 {
-    ESP_LOGD(TAG, "Partial in!");
-
     // Panel setting: accept LUT from registers instead of OTP
 #if defined (CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT_INVERTED)
     uint8_t pst_use_reg_lut[] = { 0xf3, 0x0e };
-#elif defined(CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT)
+#elif defined(CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT) || defined(CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE) || \
+      defined(CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE_INVERTED)
     uint8_t pst_use_reg_lut[] = { 0xff, 0x0e };
 #else
-#error "Unsupported orientation - only portrait modes are supported for now"
+#error "Unsupported orientation"
 #endif
     jd79653a_spi_send_cmd(0x00);
     jd79653a_spi_send_data(pst_use_reg_lut, sizeof(pst_use_reg_lut));
+}
+
+static void jd79653a_partial_in()
+{
+    ESP_LOGD(TAG, "Partial in!");
+
+    jd79653a_use_reg_lut();
 
     // WORKAROUND: need to ignore OLD framebuffer or otherwise partial refresh won't work
     uint8_t vcom = 0xb7;
@@ -260,10 +369,12 @@ static void jd79653a_partial_in()
     jd79653a_spi_send_data(&vcom, 1);
 
     // Dump LUT in
-    jd79653a_load_partial_lut();
+    partial_fast = epd_policy_is_fast();
+    jd79653a_load_lut(partial_fast ? &lut_fast : &lut_partial);
 
     // Go partial!
     jd79653a_spi_send_cmd(0x91);
+    partial_mode = true;
 }
 
 static void jd79653a_partial_out()
@@ -273,10 +384,11 @@ static void jd79653a_partial_out()
     // Panel setting: use LUT from OTP
 #if defined (CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT_INVERTED)
     uint8_t pst_use_otp_lut[] = { 0xd3, 0x0e };
-#elif defined(CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT)
+#elif defined(CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT) || defined(CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE) || \
+      defined(CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE_INVERTED)
     uint8_t pst_use_otp_lut[] = { 0xdf, 0x0e };
 #else
-#error "Unsupported orientation - only portrait modes are supported for now"
+#error "Unsupported orientation"
 #endif
     jd79653a_spi_send_cmd(0x00);
     jd79653a_spi_send_data(pst_use_otp_lut, sizeof(pst_use_otp_lut));
@@ -288,103 +400,215 @@ static void jd79653a_partial_out()
 
     // Out from partial!
     jd79653a_spi_send_cmd(0x92);
+    partial_mode = false;
 }
 
-static void jd79653a_update_partial(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint8_t *data)
+// Set the partial window and write its rows/bytes of "src" (a whole frame) to OLD (0x10) or NEW (0x13) RAM.
+// Out of partial mode the window only applies between 0x91 and 0x92.
+static void jd79653a_write_window(uint8_t cmd, const lv_area_t *area, const uint8_t *src)
 {
-    jd79653a_power_on();
-    jd79653a_partial_in();
-    ESP_LOGD(TAG, "x1: 0x%x, x2: 0x%x, y1: 0x%x, y2: 0x%x", x1, x2, y1, y2);
+    // The rounder keeps x1/x2 on byte boundaries, so the window is (x2 - x1 + 1) / 8 bytes wide
+    size_t row_len = lv_area_get_width(area) / 8u;
+    const uint8_t *data_ptr = src + (area->y1 * EPD_ROW_LEN) + (area->x1 / 8u);
 
-    size_t len = ((x2 - x1 + 1) * (y2 - y1 + 1)) / 8;
-    ESP_LOGD(TAG, "Writing PARTIAL LVGL fb with len: %u", len);
-
-    // Set partial window
-    uint8_t ptl_setting[7] = { x1, x2, 0, y1, 0, y2, 0x01 };
+    // Set partial window, HRST/HRED take bits [7:3] only
+    uint8_t ptl_setting[7] = { area->x1, area->x2, 0, area->y1, 0, area->y2, 0x01 };
     jd79653a_spi_send_cmd(0x90);
     jd79653a_spi_send_data(ptl_setting, sizeof(ptl_setting));
 
-    uint8_t *data_ptr = data;
-
-    jd79653a_spi_send_cmd(0x13);
-    for (size_t h_idx = 0; h_idx < EPD_HEIGHT; h_idx++) {
-        jd79653a_spi_send_data(data_ptr, EPD_ROW_LEN);
+    // Only the window rows/bytes, the controller wraps at HRED by itself
+    jd79653a_spi_send_cmd(cmd);
+    for (lv_coord_t y = area->y1; y <= area->y2; y++) {
+        jd79653a_spi_send_data((uint8_t *) data_ptr, row_len);
         data_ptr += EPD_ROW_LEN;
-        len -= EPD_ROW_LEN;
+    }
+}
+
+// Remember what goes on the panel, called with the frame locked
+static void jd79653a_keep_window(const lv_area_t *area)
+{
+    size_t row_len = lv_area_get_width(area) / 8u;
+    size_t offset = (area->y1 * EPD_ROW_LEN) + (area->x1 / 8u);
+
+    for (lv_coord_t y = area->y1; y <= area->y2; y++) {
+        memcpy(shown + offset, frame + offset, row_len);
+        offset += EPD_ROW_LEN;
     }
 
+    lv_area_copy(&sent_area, area);
+}
+
+static void jd79653a_update_partial(const lv_area_t *area)
+{
+    jd79653a_power_on();
+    // Fast mode stays partial between updates, only switch the LUTs when the mode changed
+    if (!partial_mode || partial_fast != epd_policy_is_fast()) {
+        jd79653a_partial_in();
+    }
+    ESP_LOGD(TAG, "x1: 0x%x, x2: 0x%x, y1: 0x%x, y2: 0x%x", area->x1, area->x2, area->y1, area->y2);
+    ESP_LOGD(TAG, "Writing PARTIAL fb with len: %u", (lv_area_get_width(area) / 8u) * lv_area_get_height(area));
+
+    // OLD RAM already holds what the panel shows
+    jd79653a_write_window(0x13, area, frame);
+    jd79653a_keep_window(area);
+
     ESP_LOGD(TAG, "Partial wait start");
 
     jd79653a_spi_send_cmd(0x12);
+}
+
+static void jd79653a_partial_finish(void)
+{
     jd79653a_wait_busy(0);
 
     ESP_LOGD(TAG, "Partial updated");
-    jd79653a_partial_out();
-    jd79653a_power_off();
+
+    // The window is on the panel now, it's the OLD data of the next refresh
+    jd79653a_write_window(0x10, &sent_area, shown);
+
+    // Fast mode stays partial and powered for the next update, jd79653a_idle() turns it off
+    if (!epd_policy_is_fast()) {
+        jd79653a_partial_out();
+        jd79653a_power_off();
+    }
 }
 
-void jd79653a_fb_set_full_color(uint8_t color)
+static void jd79653a_full_upload(const lv_area_t *area)
 {
+    if (partial_mode) {
+        jd79653a_partial_out();
+    }
     jd79653a_power_on();
-    uint8_t old_data[EPD_ROW_LEN];
-    memset(old_data, ~(color), EPD_ROW_LEN);
 
-    // Fill OLD data (maybe not necessary)
-    jd79653a_spi_send_cmd(0x10);
-    for (size_t idx = 0; idx < EPD_HEIGHT; idx++) {
-        jd79653a_spi_send_data(old_data, EPD_ROW_LEN);
-    }
+    if (ram_valid) {
+        // Both RAMs hold what the panel shows, only the window changed
+        ESP_LOGD(TAG, "Performing full update, len: %u", (lv_area_get_width(area) / 8u) * lv_area_get_height(area));
+        jd79653a_spi_send_cmd(0x91);
+        jd79653a_write_window(0x13, area, frame);
+        jd79653a_spi_send_cmd(0x92);
+        jd79653a_keep_window(area);
+    } else {
+        ESP_LOGD(TAG, "Performing full update, len: %u", sizeof(frame));
+        uint8_t *old_ptr = shown;
+        uint8_t *data_ptr = frame;
+
+        // Fill OLD data with our best guess of what the panel shows
+        jd79653a_spi_send_cmd(0x10);
+        for (size_t idx = 0; idx < EPD_HEIGHT; idx++) {
+            jd79653a_spi_send_data(old_ptr, EPD_ROW_LEN);
+            old_ptr += EPD_ROW_LEN;
+        }
 
-    // Fill NEW data
-    jd79653a_spi_send_cmd(0x13);
-    for (size_t h_idx = 0; h_idx < EPD_HEIGHT; h_idx++) {
-        for (size_t w_idx = 0; w_idx < EPD_ROW_LEN; w_idx++) {
-            jd79653a_spi_send_data(&color, sizeof(color));
+        // Fill NEW data
+        jd79653a_spi_send_cmd(0x13);
+        for (size_t h_idx = 0; h_idx < EPD_HEIGHT; h_idx++) {
+            jd79653a_spi_send_data(data_ptr, EPD_ROW_LEN);
+            data_ptr += EPD_ROW_LEN;
         }
+
+        jd79653a_keep_window(&full_area);
     }
 
     jd79653a_spi_send_cmd(0x12); // Issue refresh command
+}
+
+static void jd79653a_full_finish(void)
+{
     vTaskDelay(pdMS_TO_TICKS(100));
     jd79653a_wait_busy(0);
 
+    // The window is on the panel now, it's the OLD data of the next refresh
+    jd79653a_spi_send_cmd(0x91);
+    jd79653a_write_window(0x10, &sent_area, shown);
+    jd79653a_spi_send_cmd(0x92);
+    ram_valid = true;
+
     jd79653a_power_off();
 }
 
-void jd79653a_fb_full_update(uint8_t *data, size_t len)
+#if defined (CONFIG_LV_EPD_GRAY4)
+// Refresh the window with the gray LUTs, from both bit planes
+static void jd79653a_gray_upload(const lv_area_t *area)
 {
     jd79653a_power_on();
-    ESP_LOGD(TAG, "Performing full update, len: %u", len);
 
-    uint8_t *data_ptr = data;
+    jd79653a_use_reg_lut();
 
-    // Fill OLD data (maybe not necessary)
-    uint8_t old_data[EPD_ROW_LEN] = { 0 };
-    jd79653a_spi_send_cmd(0x10);
-    for (size_t idx = 0; idx < EPD_HEIGHT; idx++) {
-        jd79653a_spi_send_data(old_data, EPD_ROW_LEN);
-    }
+    // Unlike the partial LUTs these need the OLD data
+    uint8_t vcom = 0x97;
+    jd79653a_spi_send_cmd(0x50);
+    jd79653a_spi_send_data(&vcom, 1);
 
-    // Fill NEW data
-    jd79653a_spi_send_cmd(0x13);
-    for (size_t h_idx = 0; h_idx < EPD_HEIGHT; h_idx++) {
-        jd79653a_spi_send_data(data_ptr, EPD_ROW_LEN);
-        data_ptr += EPD_ROW_LEN;
-        len -= EPD_ROW_LEN;
-    }
+    jd79653a_load_lut(&lut_gray);
+
+    jd79653a_spi_send_cmd(0x91);
+    partial_mode = true;
+    jd79653a_write_window(0x10, area, frame_hi);
+    jd79653a_write_window(0x13, area, frame);
 
-    ESP_LOGD(TAG, "Rest len: %u", len);
+    jd79653a_spi_send_cmd(0x12);
+}
 
-    jd79653a_spi_send_cmd(0x12); // Issue refresh command
-    vTaskDelay(pdMS_TO_TICKS(100));
+static void jd79653a_gray_finish(void)
+{
     jd79653a_wait_busy(0);
 
+    // OLD RAM holds a bit plane instead of what the panel shows
+    ram_valid = false;
+
+    jd79653a_partial_out();
     jd79653a_power_off();
 }
+#endif
+
+// Runs in the epd_refresh task once no update came for EPD_POWER_OFF_MS
+static void jd79653a_idle(void)
+{
+    epd_refresh_lock();
+    if (partial_mode) {
+        jd79653a_partial_out();
+    }
+    if (powered) {
+        jd79653a_power_off();
+    }
+    epd_refresh_unlock();
+}
+
+void jd79653a_fb_set_full_color(uint8_t color)
+{
+    epd_refresh_wait();
+
+    epd_refresh_lock();
+    memset(frame, color, sizeof(frame));
+#if defined (CONFIG_LV_EPD_GRAY4)
+    memset(frame_hi, color, sizeof(frame_hi));
+#endif
+    // Finish under the lock too, so neither the refresh task nor jd79653a_idle() talk to the panel mid-waveform
+    jd79653a_full_upload(&full_area);
+    jd79653a_full_finish();
+    epd_refresh_unlock();
+}
+
+void jd79653a_fb_full_update(uint8_t *data, size_t len)
+{
+    epd_refresh_wait();
+
+    // Later partial updates are sent from the frame copy
+    epd_refresh_lock();
+    memcpy(frame, data, sizeof(frame));
+#if defined (CONFIG_LV_EPD_GRAY4)
+    memcpy(frame_hi, data, sizeof(frame_hi));
+#endif
+    jd79653a_full_upload(&full_area);
+    jd79653a_full_finish();
+    epd_refresh_unlock();
+}
 
 void jd79653a_lv_set_fb_cb(struct _disp_drv_t *disp_drv, uint8_t *buf, lv_coord_t buf_w, lv_coord_t x, lv_coord_t y,
                            lv_color_t color, lv_opa_t opa)
 {
-    uint16_t byte_index = (x >> 3u) + (y * EPD_ROW_LEN);
+    // buf holds the rounded area only, buf_w is a multiple of 8
+    uint16_t byte_index = (x >> 3u) + (y * (buf_w >> 3u));
     uint8_t bit_index = x & 0x07u;
 
     if (color.full) {
@@ -396,42 +620,121 @@ void jd79653a_lv_set_fb_cb(struct _disp_drv_t *disp_drv, uint8_t *buf, lv_coord_
 
 void jd79653a_lv_rounder_cb(struct _disp_drv_t *disp_drv, lv_area_t *area)
 {
-    // Always send full framebuffer if it's not in partial mode
-    area->x1 = 0;
-    area->y1 = 0;
-    area->x2 = EPD_WIDTH - 1;
-    area->y2 = EPD_HEIGHT - 1;
+    // The frame copy holds the rest of the screen, so even full refreshes only need the
+    // area to start and end on the controller's byte boundary (after rotation)
+    if (disp_mono_native(disp_drv)) {
+        disp_mono_round_rows(area, EPD_ROT);
+    } else {
+        area->x1 &= ~0x07;
+        area->x2 |= 0x07;
+    }
 }
 
-void jd79653a_lv_fb_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+// Runs in the epd_refresh task with the frame locked
+static epd_refresh_finish_cb_t jd79653a_upload(const lv_area_t *area)
+{
+    ESP_LOGD(TAG, "Refreshing x1: 0x%x, x2: 0x%x, y1: 0x%x, y2: 0x%x", area->x1, area->x2, area->y1, area->y2);
+
+#if defined (CONFIG_LV_EPD_GRAY4)
+    jd79653a_gray_upload(area);
+    return jd79653a_gray_finish;
+#else
+    if (!ram_valid) {
+        epd_policy_force_full();
+    }
+
+    if (epd_policy_update(area)) {
+        ESP_LOGD(TAG, "Refreshing in FULL");
+        jd79653a_full_upload(area);
+        return jd79653a_full_finish;
+    }
+
+    jd79653a_update_partial(area);
+    return jd79653a_partial_finish;
+#endif
+}
+
+// Benchmark uploads, each runs one waveform regardless of the policy and the gray mode
+static epd_refresh_finish_cb_t jd79653a_bench_full(const lv_area_t *area)
+{
+    jd79653a_full_upload(area);
+    return jd79653a_full_finish;
+}
+
+static epd_refresh_finish_cb_t jd79653a_bench_partial(const lv_area_t *area)
+{
+    jd79653a_update_partial(area);
+    return jd79653a_partial_finish;
+}
+
+#if defined (CONFIG_LV_EPD_GRAY4)
+static epd_refresh_finish_cb_t jd79653a_bench_gray(const lv_area_t *area)
 {
-    size_t len = ((area->x2 - area->x1 + 1) * (area->y2 - area->y1 + 1)) / 8;
+    jd79653a_gray_upload(area);
+    return jd79653a_gray_finish;
+}
+#endif
 
+void jd79653a_lv_fb_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
     ESP_LOGD(TAG, "x1: 0x%x, x2: 0x%x, y1: 0x%x, y2: 0x%x", area->x1, area->x2, area->y1, area->y2);
-    ESP_LOGD(TAG, "Writing LVGL fb with len: %u, partial counter: %u", len, partial_counter);
 
-    uint8_t *buf = (uint8_t *) color_map;
+    // Keep the area and let epd_refresh merge it with whatever else changes until the panel is idle
+    if (disp_mono_native(drv)) {
+        lv_area_t fb_area;
 
-    if (partial_counter == 0) {
-        ESP_LOGD(TAG, "Refreshing in FULL");
-        jd79653a_fb_full_update(buf, ((EPD_HEIGHT * EPD_WIDTH) / 8));
-        partial_counter = EPD_PARTIAL_CNT; // Reset partial counter here
+        epd_refresh_lock();
+#if defined (CONFIG_LV_EPD_GRAY4)
+        disp_mono_pack_planes(area, color_map, EPD_ROT, frame_hi, frame, EPD_ROW_LEN, 1, &fb_area);
+#else
+        disp_mono_pack_rows(area, color_map, EPD_ROT, frame, EPD_ROW_LEN, 1, &fb_area);
+#endif
+        epd_refresh_unlock();
+
+        epd_refresh_mark(drv, &fb_area);
     } else {
-        jd79653a_update_partial(area->x1, area->y1, area->x2, area->y2, buf);
-        partial_counter -= 1;   // ...or otherwise, decrease 1
-    }
+        epd_refresh_lock();
+        epd_refresh_copy_rows(frame, EPD_ROW_LEN, area, (uint8_t *) color_map);
+#if defined (CONFIG_LV_EPD_GRAY4)
+        // Black and white only, both planes hold the same
+        epd_refresh_copy_rows(frame_hi, EPD_ROW_LEN, area, (uint8_t *) color_map);
+#endif
+        epd_refresh_unlock();
 
-    lv_disp_flush_ready(drv);
+        epd_refresh_mark(drv, area);
+    }
 }
 
 void jd79653a_deep_sleep()
 {
+    epd_refresh_wait();
+
+    epd_refresh_lock();
+    // RAM is lost, start over with a full refresh of the whole frame
+    ram_valid = false;
+    partial_mode = false;
+    powered = false;
     jd79653a_spi_send_seq(power_off_seq, EPD_SEQ_LEN(power_off_seq));
     jd79653a_wait_busy(1000);
 
     uint8_t check_code = 0xa5;
     jd79653a_spi_send_cmd(0x07);
     jd79653a_spi_send_data(&check_code, sizeof(check_code));
+    epd_refresh_unlock();
+}
+
+void jd79653a_benchmark(uint8_t rounds, epd_refresh_stats_t results[EPD_BENCH_COUNT])
+{
+    // Gray last in every round, so the panel ends up with what the gray mode would show
+    const epd_refresh_upload_cb_t uploads[EPD_BENCH_COUNT] = {
+        [EPD_BENCH_FULL] = jd79653a_bench_full,
+        [EPD_BENCH_PARTIAL] = jd79653a_bench_partial,
+#if defined (CONFIG_LV_EPD_GRAY4)
+        [EPD_BENCH_GRAY] = jd79653a_bench_gray,
+#endif
+    };
+
+    epd_refresh_benchmark(uploads, &full_area, rounds, results);
 }
 
 void jd79653a_init()
@@ -478,5 +781,9 @@ void jd79653a_init()
     // Check BUSY status here
     jd79653a_wait_busy(0);
 
+    // Refresh in the background instead of the flush callback
+    epd_refresh_init(jd79653a_upload);
+    epd_refresh_set_idle(jd79653a_idle, EPD_POWER_OFF_MS);
+
     ESP_LOGI(TAG, "Panel is up!");
 }
@@ -17,6 +17,8 @@ extern "C"
 #include "lvgl/lvgl.h"
 #endif
 
+#include "epd_refresh.h"
+
 void jd79653a_init();
 void jd79653a_deep_sleep();
 
@@ -28,6 +30,10 @@ void jd79653a_lv_fb_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t
 void jd79653a_fb_set_full_color(uint8_t color);
 void jd79653a_fb_full_update(uint8_t *data, size_t len);
 
+// Time "rounds" whole-screen refreshes with each waveform (full, partial and with CONFIG_LV_EPD_GRAY4 gray),
+// results are indexed by EPD_BENCH_FULL etc. and logged. The panel shows the frame again afterwards.
+void jd79653a_benchmark(uint8_t rounds, epd_refresh_stats_t results[EPD_BENCH_COUNT]);
+
 
 #ifdef __cplusplus
 } /* extern "C" */
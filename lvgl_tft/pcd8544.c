@@ -14,6 +14,7 @@
 #include "freertos/task.h"
 
 #include "pcd8544.h"
+#include "disp_mono.h"
 
 #define TAG "lv_pcd8544"
 
@@ -24,6 +25,21 @@
 #define BIT_SET(a,b) ((a) |= (1U<<(b)))
 #define BIT_CLEAR(a,b) ((a) &= ~(1U<<(b)))
 
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+static uint8_t packed[DISP_MONO_BUF_SIZE];
+static uint8_t shadow_data[DISP_MONO_BUF_SIZE];
+
+/* a column window costs two command transactions */
+static disp_mono_shadow_t shadow = {
+    .data = shadow_data,
+    .columns = LV_HOR_RES_MAX,
+    .pages = (LV_VER_RES_MAX + 7) / 8,
+    .gap = 4,
+};
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -42,10 +58,12 @@ static void pcd8544_send_data(void * data, uint16_t length)
     disp_spi_send_data(data, length);
 }
 
-static void pcd8544_send_colors(void * data, uint16_t length)
+/* write one run of changed columns of a bank */
+static void pcd8544_send_run(uint8_t bank, uint16_t column, const uint8_t * data, uint16_t len)
 {
-    gpio_set_level(PCD8544_DC, 1);	 /*Data mode*/
-    disp_spi_send_colors(data, length);
+    pcd8544_send_cmd(0x40 | bank);      /* set Y address */
+    pcd8544_send_cmd(0x80 | column);    /* set X address */
+    pcd8544_send_data((void *) data, len);
 }
 
 /**********************
@@ -86,13 +104,8 @@ void pcd8544_set_contrast (uint8_t contrast){
 }
 
 void pcd8544_rounder(lv_disp_drv_t * disp_drv, lv_area_t *area){
-    uint8_t hor_max = disp_drv->hor_res;
-    uint8_t ver_max = disp_drv->ver_res;
-
-    area->x1 = 0;
-    area->y1 = 0;
-    area->x2 = hor_max - 1;
-    area->y2 = ver_max - 1;
+    // set_px_cb places pixels relative to the area, whole banks are enough
+    disp_mono_round_vpages(area);
 }
 
 void pcd8544_set_px_cb(lv_disp_drv_t * disp_drv, uint8_t * buf, lv_coord_t buf_w, lv_coord_t x, lv_coord_t y,
@@ -116,33 +129,15 @@ void pcd8544_flush(lv_disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t
 
     uint8_t * buf = (uint8_t *) color_map;
 
-    // Check if the whole frame buffer can be sent in a single SPI transaction
-
-    if ((area->x1 == 0) && (area->y1 == 0) && (area->x2 == (disp_drv->hor_res - 1)) && (area->y2 == (disp_drv->ver_res - 1))){
-
-        // send complete frame buffer at once. 
-        // NOTE: disp_spi_send_colors triggers lv_disp_flush_ready
-
-        pcd8544_send_cmd(0x40);  /* set Y address */
-        pcd8544_send_cmd(0x80);  /* set X address */
-        pcd8544_send_colors(buf, disp_drv->hor_res * disp_drv->ver_res / 8);
-
-    } else {
-
-        // send horizontal tiles
+    if (disp_mono_native(disp_drv)){
+        // LVGL rendered one lv_color_t per pixel, pack the area into banks
+        disp_mono_pack_vpages(area, color_map, packed);
+        buf = packed;
+    }
 
-        uint16_t bank_start =  area->y1 / 8;
-        uint16_t bank_end   =  area->y2 / 8;
+    // only the columns that changed since the last flush go over the bus
 
-        uint16_t bank;
-        uint16_t cols_to_update = area->x2 - area->x1 + 1;
-        for (bank = bank_start ; bank <= bank_end ; bank++ ){
-            pcd8544_send_cmd(0x40 | bank );      /* set Y address */
-            pcd8544_send_cmd(0x80 | area->x1 );  /* set X address */
-            uint16_t offset = bank * disp_drv->hor_res + area->x1;
-            pcd8544_send_data(&buf[offset], cols_to_update);
-        }
+    disp_mono_shadow_send(&shadow, area->y1 / 8, area->y2 / 8, area->x1, lv_area_get_width(area), buf, pcd8544_send_run);
 
-        lv_disp_flush_ready(disp_drv);
-    }
+    lv_disp_flush_ready(disp_drv);
 }
@@ -8,6 +8,7 @@
  *********************/
 #include "sh1107.h"
 #include "disp_spi.h"
+#include "disp_mono.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
@@ -34,11 +35,30 @@ typedef struct {
  **********************/
 static void sh1107_send_cmd(uint8_t cmd);
 static void sh1107_send_data(void * data, uint16_t length);
-static void sh1107_send_color(void * data, uint16_t length);
+static void sh1107_send_run(uint8_t page, uint16_t column, const uint8_t * data, uint16_t len);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
+static uint8_t packed[DISP_MONO_BUF_SIZE];
+static uint8_t shadow_data[DISP_MONO_BUF_SIZE];
+
+/* a column window costs one queued 3 byte command transaction */
+static disp_mono_shadow_t shadow = {
+    .data = shadow_data,
+#if defined CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE
+    .columns = LV_VER_RES_MAX,
+    .pages = (LV_HOR_RES_MAX + 7) / 8,
+#else
+    .columns = LV_HOR_RES_MAX,
+    .pages = (LV_VER_RES_MAX + 7) / 8,
+#endif
+    .gap = 4,
+};
+
+/* data of the last run, queued at the end of the flush with the flush signal */
+static const uint8_t *pending_data;
+static uint16_t pending_len;
 
 /**********************
  *      MACROS
@@ -143,41 +163,55 @@ void sh1107_set_px_cb(struct _disp_drv_t * disp_drv, uint8_t * buf, lv_coord_t b
 
 void sh1107_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_map)
 {
-    uint8_t columnLow = area->x1 & 0x0F;
-	uint8_t columnHigh = (area->x1 >> 4) & 0x0F;
-    uint8_t row1 = 0, row2 = 0;
-    uint32_t size = 0;
-    void *ptr;
+    uint8_t *pages = (uint8_t *) color_map;
+    uint8_t page1, page2;
+    uint16_t column, width;
 
 #if defined CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE
-    row1 = area->x1>>3;
-    row2 = area->x2>>3;
-#else
-    row1 = area->y1>>3;
-    row2 = area->y2>>3;
-#endif
-    for(int i = row1; i < row2+1; i++){
-	    sh1107_send_cmd(0x10 | columnHigh);         // Set Higher Column Start Address for Page Addressing Mode
-	    sh1107_send_cmd(0x00 | columnLow);          // Set Lower Column Start Address for Page Addressing Mode
-	    sh1107_send_cmd(0xB0 | i);                  // Set Page Start Address for Page Addressing Mode
-	    size = area->y2 - area->y1 + 1;
-#if defined CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE
-        ptr = color_map + i * LV_VER_RES_MAX;
+    /* pages are 8 pixels wide, the controller columns run along y */
+    page1 = area->x1 >> 3;
+    page2 = area->x2 >> 3;
+    column = area->y1;
+    width = lv_area_get_height(area);
+    if (disp_mono_native(drv)) {
+        disp_mono_pack_hpages(area, color_map, packed);
+        pages = packed;
+    }
 #else
-        ptr = color_map + i * LV_HOR_RES_MAX;
+    page1 = area->y1 >> 3;
+    page2 = area->y2 >> 3;
+    column = area->x1;
+    width = lv_area_get_width(area);
+    if (disp_mono_native(drv)) {
+        disp_mono_pack_vpages(area, color_map, packed);
+        pages = packed;
+    }
 #endif
-        if(i != row2){
-	    sh1107_send_data( (void *) ptr, size);
-	} else {
-	    // complete sending data by sh1107_send_color() and thus call lv_flush_ready()
-	    sh1107_send_color( (void *) ptr, size);
-	}
+
+    /* only the columns that changed since the last flush go over the bus, everything is queued */
+    pending_len = 0;
+    disp_mono_shadow_send(&shadow, page1, page2, column, width, pages, sh1107_send_run);
+
+    if (pending_len) {
+        /* lv_disp_flush_ready() is called once the last page is out */
+        disp_spi_transaction(pending_data, pending_len, DISP_SPI_SEND_QUEUED | DISP_SPI_DC_DATA | DISP_SPI_SIGNAL_FLUSH, NULL, 0, 0);
+    } else {
+        lv_disp_flush_ready(drv);
     }
 }
 
 void sh1107_rounder(struct _disp_drv_t * disp_drv, lv_area_t *area)
 {
-    // workaround: always send complete size display buffer
+    if (disp_mono_native(disp_drv)) {
+#if defined CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE
+        disp_mono_round_hpages(area);
+#else
+        disp_mono_round_vpages(area);
+#endif
+        return;
+    }
+
+    // sh1107_set_px_cb() expects the complete display buffer
     area->x1 = 0;
     area->y1 = 0;
     area->x2 = LV_HOR_RES_MAX-1;
@@ -213,9 +247,22 @@ static void sh1107_send_data(void * data, uint16_t length)
     disp_spi_send_data(data, length);
 }
 
-static void sh1107_send_color(void * data, uint16_t length)
+/* queue one run of changed columns of a page, its data goes out with the next run or at the end of the flush */
+static void sh1107_send_run(uint8_t page, uint16_t column, const uint8_t * data, uint16_t len)
 {
-    disp_wait_for_pending_transactions();
-    gpio_set_level(SH1107_DC, 1);   /*Data mode*/
-    disp_spi_send_colors(data, length);
+    uint8_t cmds[] = {
+        0x10 | ((column >> 4) & 0x0F),  // Set Higher Column Start Address for Page Addressing Mode
+        0x00 | (column & 0x0F),         // Set Lower Column Start Address for Page Addressing Mode
+        0xB0 | page,                    // Set Page Start Address for Page Addressing Mode
+    };
+
+    if (pending_len) {
+        disp_spi_transaction(pending_data, pending_len, DISP_SPI_SEND_QUEUED | DISP_SPI_DC_DATA, NULL, 0, 0);
+    }
+
+    /* up to 4 bytes are copied into the transaction, the stack is fine */
+    disp_spi_transaction(cmds, sizeof(cmds), DISP_SPI_SEND_QUEUED | DISP_SPI_DC_CMD, NULL, 0, 0);
+
+    pending_data = data;
+    pending_len = len;
 }
@@ -15,16 +15,26 @@
  *********************/
 #include "assert.h"
 
+#if defined (CONFIG_LV_TFT_DISPLAY_PROTOCOL_SPI)
+#include "disp_spi.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
 #include "lvgl_i2c/i2c_manager.h"
+#endif
 
 #include "ssd1306.h"
+#include "disp_mono.h"
 
 /*********************
  *      DEFINES
  *********************/
 #define TAG "SSD1306"
 
+#if !defined (CONFIG_LV_TFT_DISPLAY_PROTOCOL_SPI)
 #define OLED_I2C_PORT                       (CONFIG_LV_I2C_DISPLAY_PORT)
+#endif
 // SLA (0x3C) + WRITE_MODE (0x00) =  0x78 (0b01111000)
 #define OLED_I2C_ADDRESS                    0x3C
 #define OLED_WIDTH                          128
@@ -78,11 +88,27 @@
  *  STATIC PROTOTYPES
  **********************/
 static uint8_t send_data(lv_disp_drv_t *disp_drv, void *bytes, size_t bytes_len);
-static uint8_t send_pixels(lv_disp_drv_t *disp_drv, void *color_buffer, size_t buffer_len);
+static void send_run(uint8_t page, uint16_t column, const uint8_t * data, uint16_t len);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
+static uint8_t packed[DISP_MONO_BUF_SIZE];
+static uint8_t shadow_data[DISP_MONO_BUF_SIZE];
+
+/* a column window costs 13 bytes */
+static disp_mono_shadow_t shadow = {
+    .data = shadow_data,
+    .columns = LV_HOR_RES_MAX,
+    .pages = (LV_VER_RES_MAX + 7) / 8,
+    .gap = 12,
+};
+
+#if defined (CONFIG_LV_TFT_DISPLAY_PROTOCOL_SPI)
+/* data of the last run, queued at the end of the flush with the flush signal */
+static const uint8_t *pending_data;
+static uint16_t pending_len;
+#endif
 
 /**********************
  *      MACROS
@@ -117,10 +143,29 @@ void ssd1306_init(void)
     display_mode = OLED_CMD_DISPLAY_NORMAL;
 #endif
 
+#if defined (CONFIG_LV_TFT_DISPLAY_PROTOCOL_SPI)
+    /* Initialize non-SPI GPIOs */
+    gpio_pad_select_gpio(SSD1306_DC);
+    gpio_set_direction(SSD1306_DC, GPIO_MODE_OUTPUT);
+
+#if SSD1306_USE_RST
+    gpio_pad_select_gpio(SSD1306_RST);
+    gpio_set_direction(SSD1306_RST, GPIO_MODE_OUTPUT);
+
+    /* Reset the display, RES# has to be low for at least 3 us */
+    gpio_set_level(SSD1306_RST, 0);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    gpio_set_level(SSD1306_RST, 1);
+    vTaskDelay(pdMS_TO_TICKS(10));
+#endif
+#endif
+
     uint8_t conf[] = {
         OLED_CONTROL_BYTE_CMD_STREAM,
         OLED_CMD_SET_CHARGE_PUMP,
         0x14,
+        OLED_CMD_SET_MEMORY_ADDR_MODE,
+        0x00,
         orientation_1,
         orientation_2,
         OLED_CMD_SET_CONTRAST,
@@ -152,35 +197,36 @@ void ssd1306_flush(lv_disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t
     uint8_t row1 = area->y1 >> 3;
     uint8_t row2 = area->y2 >> 3;
 
-    uint8_t conf[] = {
-        OLED_CONTROL_BYTE_CMD_STREAM,
-        OLED_CMD_SET_MEMORY_ADDR_MODE,
-        0x00,
-        OLED_CMD_SET_COLUMN_RANGE,
-        (uint8_t) area->x1,
-        (uint8_t) area->x2,
-        OLED_CMD_SET_PAGE_RANGE,
-        row1,
-        row2,
-    };
+    uint8_t *pages = (uint8_t *) color_p;
 
-    uint8_t err = send_data(disp_drv, conf, sizeof(conf));
-    assert(0 == err);
-    err = send_pixels(disp_drv, color_p, OLED_COLUMNS * (1 + row2 - row1));
-    assert(0 == err);
+    if (disp_mono_native(disp_drv)) {
+        /* LVGL rendered one lv_color_t per pixel, pack them into pages */
+        disp_mono_pack_vpages(area, color_p, packed);
+        pages = packed;
+    }
+
+#if defined (CONFIG_LV_TFT_DISPLAY_PROTOCOL_SPI)
+    /* only the columns that changed since the last flush go over the bus, everything is queued */
+    pending_len = 0;
+    disp_mono_shadow_send(&shadow, row1, row2, area->x1, lv_area_get_width(area), pages, send_run);
+
+    if (pending_len) {
+        /* lv_disp_flush_ready() is called once the last page is out */
+        disp_spi_transaction(pending_data, pending_len, DISP_SPI_SEND_QUEUED | DISP_SPI_DC_DATA | DISP_SPI_SIGNAL_FLUSH, NULL, 0, 0);
+        return;
+    }
+#else
+    /* only the columns that changed since the last flush go over the bus */
+    disp_mono_shadow_send(&shadow, row1, row2, area->x1, lv_area_get_width(area), pages, send_run);
+#endif
 
     lv_disp_flush_ready(disp_drv);
 }
 
 void ssd1306_rounder(lv_disp_drv_t * disp_drv, lv_area_t *area)
 {
-    uint8_t hor_max = disp_drv->hor_res;
-    uint8_t ver_max = disp_drv->ver_res;
-
-    area->x1 = 0;
-    area->y1 = 0;
-    area->x2 = hor_max - 1;
-    area->y2 = ver_max - 1;
+    /* set_px_cb places pixels relative to the area, whole pages are enough */
+    disp_mono_round_vpages(area);
 }
 
 void ssd1306_sleep_in(void)
@@ -208,18 +254,72 @@ void ssd1306_sleep_out(void)
 /**********************
  *   STATIC FUNCTIONS
  **********************/
+#if defined (CONFIG_LV_TFT_DISPLAY_PROTOCOL_SPI)
+
+/* commands go out with DC low, the control byte in bytes[0] is only needed on I2C */
 static uint8_t send_data(lv_disp_drv_t *disp_drv, void *bytes, size_t bytes_len)
 {
     (void) disp_drv;
 
     uint8_t *data = (uint8_t *) bytes;
 
-    return lvgl_i2c_write(OLED_I2C_PORT, OLED_I2C_ADDRESS, data[0], data + 1, bytes_len - 1 );
+    disp_wait_for_pending_transactions();
+    gpio_set_level(SSD1306_DC, 0);     /*Command mode*/
+    disp_spi_send_data(data + 1, bytes_len - 1);
+
+    return 0;
 }
 
-static uint8_t send_pixels(lv_disp_drv_t *disp_drv, void *color_buffer, size_t buffer_len)
+/* queue one run of changed columns of a page, its data goes out with the next run or at the end of the flush */
+static void send_run(uint8_t page, uint16_t column, const uint8_t * data, uint16_t len)
+{
+    uint8_t columns[] = { OLED_CMD_SET_COLUMN_RANGE, (uint8_t) column, (uint8_t) (column + len - 1) };
+    uint8_t pages[] = { OLED_CMD_SET_PAGE_RANGE, page, page };
+
+    if (pending_len) {
+        disp_spi_transaction(pending_data, pending_len, DISP_SPI_SEND_QUEUED | DISP_SPI_DC_DATA, NULL, 0, 0);
+    }
+
+    /* up to 4 bytes are copied into the transaction, the stack is fine */
+    disp_spi_transaction(columns, sizeof(columns), DISP_SPI_SEND_QUEUED | DISP_SPI_DC_CMD, NULL, 0, 0);
+    disp_spi_transaction(pages, sizeof(pages), DISP_SPI_SEND_QUEUED | DISP_SPI_DC_CMD, NULL, 0, 0);
+
+    pending_data = data;
+    pending_len = len;
+}
+
+#else
+
+static uint8_t send_data(lv_disp_drv_t *disp_drv, void *bytes, size_t bytes_len)
 {
     (void) disp_drv;
 
-    return lvgl_i2c_write(OLED_I2C_PORT, OLED_I2C_ADDRESS, OLED_CONTROL_BYTE_DATA_STREAM, color_buffer, buffer_len);
+    uint8_t *data = (uint8_t *) bytes;
+
+    return lvgl_i2c_write(OLED_I2C_PORT, OLED_I2C_ADDRESS, data[0], data + 1, bytes_len - 1 );
+}
+
+/* write one run of changed columns of a page, window and data in a single I2C transaction */
+static void send_run(uint8_t page, uint16_t column, const uint8_t * data, uint16_t len)
+{
+    /* single commands, so the last control byte can switch to data */
+    uint8_t window[] = {
+        OLED_CONTROL_BYTE_CMD_SINGLE, OLED_CMD_SET_COLUMN_RANGE,
+        OLED_CONTROL_BYTE_CMD_SINGLE, (uint8_t) column,
+        OLED_CONTROL_BYTE_CMD_SINGLE, (uint8_t) (column + len - 1),
+        OLED_CONTROL_BYTE_CMD_SINGLE, OLED_CMD_SET_PAGE_RANGE,
+        OLED_CONTROL_BYTE_CMD_SINGLE, page,
+        OLED_CONTROL_BYTE_CMD_SINGLE, page,
+        OLED_CONTROL_BYTE_DATA_STREAM,
+    };
+
+    lvgl_i2c_segment_t segments[] = {
+        { window, sizeof(window) },
+        { data, len },
+    };
+
+    uint8_t err = lvgl_i2c_writev(OLED_I2C_PORT, OLED_I2C_ADDRESS, segments, 2);
+    assert(0 == err);
 }
+
+#endif
@@ -27,6 +27,11 @@ extern "C" {
  *********************/
 #define SSD1306_DISPLAY_ORIENTATION     TFT_ORIENTATION_LANDSCAPE
 
+/* SPI modules (LV_TFT_DISPLAY_USER_CONTROLLER_SSD1306_SPI) */
+#define SSD1306_DC       CONFIG_LV_DISP_PIN_DC
+#define SSD1306_RST      CONFIG_LV_DISP_PIN_RST
+#define SSD1306_USE_RST  CONFIG_LV_DISP_USE_RST
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -25,6 +25,8 @@
  */
 
 
+#include <string.h>
+
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/event_groups.h>
@@ -32,6 +34,9 @@
 #include <esp_log.h>
 
 #include "disp_spi.h"
+#include "disp_mono.h"
+#include "epd_refresh.h"
+#include "epd_policy.h"
 #include "disp_driver.h"
 #include "uc8151d.h"
 
@@ -44,9 +49,34 @@
 #define PIN_BUSY            CONFIG_LV_DISP_PIN_BUSY
 #define PIN_BUSY_BIT        ((1ULL << (uint8_t)(CONFIG_LV_DISP_PIN_BUSY)))
 #define EVT_BUSY            (1UL << 0UL)
+#define EPD_POWER_OFF_MS    1000    // Keep the charge pump on this long after the last update
+
+// Landscape keeps the panel in portrait and rotates LVGL's buffer while packing it into the frame,
+// this needs LVGL to render natively (no set_px_cb)
+#if defined (CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE)
+#define EPD_ROT             DISP_MONO_ROT_90
+#elif defined (CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE_INVERTED)
+#define EPD_ROT             DISP_MONO_ROT_270
+#else
+#define EPD_ROT             DISP_MONO_ROT_0
+#endif
+
+#if defined (CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE) || defined (CONFIG_LV_DISPLAY_ORIENTATION_LANDSCAPE_INVERTED)
+#define EPD_WIDTH           LV_VER_RES_MAX
+#define EPD_HEIGHT          LV_HOR_RES_MAX
+#else
 #define EPD_WIDTH           LV_HOR_RES_MAX
 #define EPD_HEIGHT          LV_VER_RES_MAX
-#define EPD_ROW_LEN         (EPD_HEIGHT / 8u)
+#endif
+#define EPD_ROW_LEN         (EPD_WIDTH / 8u)
+
+// Panel settings: LUT from OTP or from the registers
+#if defined (CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT_INVERTED)
+#define EPD_PSR_OTP_LUT     0x13
+#else
+#define EPD_PSR_OTP_LUT     0x1f
+#endif
+#define EPD_PSR_REG_LUT     (EPD_PSR_OTP_LUT | 0x20)
 
 #define BIT_SET(a, b)       ((a) |= (1U << (b)))
 #define BIT_CLEAR(a, b)     ((a) &= ~(1U << (b)))
@@ -62,6 +92,128 @@ typedef struct
 
 static EventGroupHandle_t uc8151d_evts = NULL;
 
+// What the panel shows (or is about to), updates are sent from here
+static uint8_t frame[EPD_ROW_LEN * EPD_HEIGHT];
+
+// What the panel shows, the controller's OLD RAM holds the same between refreshes so that
+// an update only has to send the NEW data of its window
+static uint8_t shown[EPD_ROW_LEN * EPD_HEIGHT];
+static bool awake = false;          // Reset and initialised, left by uc8151d_sleep()
+static bool powered = false;        // Charge pump on
+static bool ram_valid = false;      // OLD/NEW RAM match "shown", lost by reset and deep sleep
+static bool partial_mode = false;   // Register LUTs loaded, partial window active
+static bool partial_fast = false;   // The loaded LUTs are the fast ones
+static lv_area_t sent_area;         // Window of the running refresh, copied to OLD RAM afterwards
+
+static const lv_area_t full_area = { 0, 0, EPD_WIDTH - 1, EPD_HEIGHT - 1 };
+
+#if defined (CONFIG_LV_EPD_GRAY4)
+// 4-gray mode: bit 1 of the gray level goes to OLD RAM from here, bit 0 to NEW RAM from "frame",
+// the LUT of each OLD/NEW pair drives the pixel to its level
+static uint8_t frame_hi[EPD_ROW_LEN * EPD_HEIGHT];
+#endif
+
+// Partial refresh LUTs, one group of 4 phases: level select (2 bits per phase), 4 frame counts, repeat
+#define LUT_T1              30  // Charge balance pre-phase
+#define LUT_T2              5   // Optional extension
+#define LUT_T3              30  // Color change phase
+#define LUT_T4              5   // Optional extension for one color
+
+static const uint8_t lut_vcom_partial[44] = {
+    0x00, LUT_T1, LUT_T2, LUT_T3, LUT_T4, 0x01,
+    0x00, 0x01,   0x00,   0x00,   0x00,   0x01,    // GND phase
+};
+
+static const uint8_t lut_ww_partial[42] = {
+    0x18, LUT_T1, LUT_T2, LUT_T3, LUT_T4, 0x01,    // 00 01 10 00
+    0x00, 0x01,   0x00,   0x00,   0x00,   0x01,
+};
+
+static const uint8_t lut_bw_partial[42] = {
+    0x5a, LUT_T1, LUT_T2, LUT_T3, LUT_T4, 0x01,    // 01 01 10 10
+    0x00, 0x01,   0x00,   0x00,   0x00,   0x01,
+};
+
+static const uint8_t lut_wb_partial[42] = {
+    0xa5, LUT_T1, LUT_T2, LUT_T3, LUT_T4, 0x01,    // 10 10 01 01
+    0x00, 0x01,   0x00,   0x00,   0x00,   0x01,
+};
+
+static const uint8_t lut_bb_partial[42] = {
+    0x24, LUT_T1, LUT_T2, LUT_T3, LUT_T4, 0x01,    // 00 10 01 00
+    0x00, 0x01,   0x00,   0x00,   0x00,   0x01,
+};
+
+// Fast LUTs: drive the changed pixels once, without the charge balance phase of the partial LUTs,
+// used while epd_policy_set_fast() is on. Ghosting builds up until fast mode ends with a full refresh.
+#define LUT_T_FAST          5
+
+static const uint8_t lut_vcom_fast[44] = {
+    0x00, LUT_T_FAST, 0x00, 0x00, 0x00, 0x01,
+};
+
+static const uint8_t lut_ww_fast[42] = {
+    0x00, LUT_T_FAST, 0x00, 0x00, 0x00, 0x01,    // 00 00 00 00
+};
+
+static const uint8_t lut_bw_fast[42] = {
+    0x80, LUT_T_FAST, 0x00, 0x00, 0x00, 0x01,    // 10 00 00 00
+};
+
+static const uint8_t lut_wb_fast[42] = {
+    0x40, LUT_T_FAST, 0x00, 0x00, 0x00, 0x01,    // 01 00 00 00
+};
+
+static const uint8_t lut_bb_fast[42] = {
+    0x00, LUT_T_FAST, 0x00, 0x00, 0x00, 0x01,    // 00 00 00 00
+};
+
+#if defined (CONFIG_LV_EPD_GRAY4)
+// 4-gray LUTs: clean the window to white (black, white), then darken for 0, 2, 5 or 10 frames.
+// OLD/NEW pairs: WW white, WB light gray, BW dark gray, BB black
+static const uint8_t lut_vcom_gray[44] = {
+    0x00, 0x0a, 0x0a, 0x00, 0x00, 0x01,
+    0x00, 0x02, 0x03, 0x05, 0x00, 0x01,
+};
+
+static const uint8_t lut_ww_gray[42] = {
+    0x60, 0x0a, 0x0a, 0x00, 0x00, 0x01,    // 01 10 00 00
+    0x00, 0x02, 0x03, 0x05, 0x00, 0x01,    // 00 00 00 00
+};
+
+static const uint8_t lut_bw_gray[42] = {
+    0x60, 0x0a, 0x0a, 0x00, 0x00, 0x01,    // 01 10 00 00
+    0x50, 0x02, 0x03, 0x05, 0x00, 0x01,    // 01 01 00 00
+};
+
+static const uint8_t lut_wb_gray[42] = {
+    0x60, 0x0a, 0x0a, 0x00, 0x00, 0x01,    // 01 10 00 00
+    0x40, 0x02, 0x03, 0x05, 0x00, 0x01,    // 01 00 00 00
+};
+
+static const uint8_t lut_bb_gray[42] = {
+    0x60, 0x0a, 0x0a, 0x00, 0x00, 0x01,    // 01 10 00 00
+    0x54, 0x02, 0x03, 0x05, 0x00, 0x01,    // 01 01 01 00
+};
+#endif
+
+// One set of register LUTs: VCOM, White-to-White, Black-to-White, White-to-Black, Black-to-Black
+typedef struct
+{
+    const uint8_t *lut[5];
+    size_t len[5];
+} uc8151d_lut_set_t;
+
+#define LUT_SET(vcom, ww, bw, wb, bb) \
+    { { vcom, ww, bw, wb, bb }, { sizeof(vcom), sizeof(ww), sizeof(bw), sizeof(wb), sizeof(bb) } }
+
+static const uc8151d_lut_set_t lut_partial =
+    LUT_SET(lut_vcom_partial, lut_ww_partial, lut_bw_partial, lut_wb_partial, lut_bb_partial);
+static const uc8151d_lut_set_t lut_fast = LUT_SET(lut_vcom_fast, lut_ww_fast, lut_bw_fast, lut_wb_fast, lut_bb_fast);
+#if defined (CONFIG_LV_EPD_GRAY4)
+static const uc8151d_lut_set_t lut_gray = LUT_SET(lut_vcom_gray, lut_ww_gray, lut_bw_gray, lut_wb_gray, lut_bb_gray);
+#endif
+
 static void IRAM_ATTR uc8151d_busy_intr(void *arg)
 {
     BaseType_t xResult;
@@ -126,6 +278,8 @@ static esp_err_t uc8151d_wait_busy(uint32_t timeout_ms)
 
 static void uc8151d_sleep()
 {
+    ESP_LOGD(TAG, "Going to sleep");
+
     // Set VCOM to 0xf7
     uc8151d_spi_send_cmd(0x50);
     uc8151d_spi_send_data_byte(0xf7);
@@ -137,6 +291,26 @@ static void uc8151d_sleep()
     // Go to sleep
     uc8151d_spi_send_cmd(0x07);
     uc8151d_spi_send_data_byte(0xa5);
+
+    awake = false;
+    powered = false;
+    ram_valid = false;
+    partial_mode = false;
+}
+
+static void uc8151d_power_on()
+{
+    uc8151d_spi_send_cmd(0x04);
+    uc8151d_wait_busy(0);
+    powered = true;
+}
+
+// Unlike deep sleep, power off keeps the RAM, so partial updates can go on afterwards
+static void uc8151d_power_off()
+{
+    uc8151d_spi_send_cmd(0x02);
+    uc8151d_wait_busy(0);
+    powered = false;
 }
 
 static void uc8151d_panel_init()
@@ -150,68 +324,340 @@ static void uc8151d_panel_init()
     }
 
     // Power up
-    uc8151d_spi_send_cmd(0x04);
-    uc8151d_wait_busy(0);
+    uc8151d_power_on();
 
     // Panel settings
     uc8151d_spi_send_cmd(0x00);
-#if defined (CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT_INVERTED)
-    uc8151d_spi_send_data_byte(0x13);
-#elif defined (CONFIG_LV_DISPLAY_ORIENTATION_PORTRAIT)
-    uc8151d_spi_send_data_byte(0x1f);
-#endif
+    uc8151d_spi_send_data_byte(EPD_PSR_OTP_LUT);
 
     // VCOM & Data intervals
     uc8151d_spi_send_cmd(0x50);
     uc8151d_spi_send_data_byte(0x97);
+
+    awake = true;
+    ram_valid = false;
+    partial_mode = false;
 }
 
-static void uc8151d_full_update(uint8_t *buf)
+static void uc8151d_load_lut(const uc8151d_lut_set_t *set)
 {
-    uc8151d_panel_init();
+    for (uint8_t idx = 0; idx < 5; idx++) {
+        uc8151d_spi_send_cmd(0x20 + idx); // LUT VCOM, WW, BW, WB, BB registers
+        uc8151d_spi_send_data((uint8_t *) set->lut[idx], set->len[idx]);
+    }
+}
+
+static void uc8151d_partial_in()
+{
+    ESP_LOGD(TAG, "Partial in!");
+
+    // Panel setting: accept LUT from registers instead of OTP
+    uc8151d_spi_send_cmd(0x00);
+    uc8151d_spi_send_data_byte(EPD_PSR_REG_LUT);
 
-    uint8_t *buf_ptr = buf;
-    uint8_t old_data[EPD_ROW_LEN] = { 0 };
+    // VCOM & Data intervals: floating border, it's not part of the window
+    uc8151d_spi_send_cmd(0x50);
+    uc8151d_spi_send_data_byte(0x17);
+
+    partial_fast = epd_policy_is_fast();
+    uc8151d_load_lut(partial_fast ? &lut_fast : &lut_partial);
+
+    partial_mode = true;
+}
+
+static void uc8151d_partial_out()
+{
+    ESP_LOGD(TAG, "Partial out!");
+
+    // Panel setting: use LUT from OTP
+    uc8151d_spi_send_cmd(0x00);
+    uc8151d_spi_send_data_byte(EPD_PSR_OTP_LUT);
+
+    uc8151d_spi_send_cmd(0x50);
+    uc8151d_spi_send_data_byte(0x97);
+
+    partial_mode = false;
+}
 
-    // Fill old data
-    uc8151d_spi_send_cmd(0x10);
-    for (size_t h_idx = 0; h_idx < EPD_HEIGHT; h_idx++) {
-        uc8151d_spi_send_data(old_data, EPD_ROW_LEN);
+// Set the partial window and write its rows/bytes of "src" (a whole frame) to OLD (0x10) or NEW (0x13) RAM,
+// has to be enclosed in partial in (0x91) and out (0x92)
+static void uc8151d_write_window(uint8_t cmd, const lv_area_t *area, const uint8_t *src)
+{
+    size_t row_len = lv_area_get_width(area) / 8u;
+    const uint8_t *data_ptr = src + (area->y1 * EPD_ROW_LEN) + (area->x1 / 8u);
+
+    // HRST/HRED take bits [7:3] only, the rounder keeps x1/x2 on byte boundaries
+    uint8_t ptl_setting[7] = { area->x1, area->x2, area->y1 >> 8, area->y1, area->y2 >> 8, area->y2, 0x01 };
+    uc8151d_spi_send_cmd(0x90);
+    uc8151d_spi_send_data(ptl_setting, sizeof(ptl_setting));
+
+    uc8151d_spi_send_cmd(cmd);
+    for (lv_coord_t y = area->y1; y <= area->y2; y++) {
+        uc8151d_spi_send_data((uint8_t *) data_ptr, row_len);
+        data_ptr += EPD_ROW_LEN;
     }
+}
 
-    // Fill new data
-    uc8151d_spi_send_cmd(0x13);
-    for (size_t h_idx = 0; h_idx < EPD_HEIGHT; h_idx++) {
-        uc8151d_spi_send_data(buf_ptr, EPD_ROW_LEN);
-        buf_ptr += EPD_ROW_LEN;
+// Remember what goes on the panel, called with the frame locked
+static void uc8151d_keep_window(const lv_area_t *area)
+{
+    size_t row_len = lv_area_get_width(area) / 8u;
+    size_t offset = (area->y1 * EPD_ROW_LEN) + (area->x1 / 8u);
+
+    for (lv_coord_t y = area->y1; y <= area->y2; y++) {
+        memcpy(shown + offset, frame + offset, row_len);
+        offset += EPD_ROW_LEN;
+    }
+
+    lv_area_copy(&sent_area, area);
+}
+
+static void uc8151d_full_update(const lv_area_t *area)
+{
+    if (!ram_valid) {
+        // Whole frame, with our best guess of what the panel shows as OLD data
+        uint8_t *buf_ptr = frame;
+        uint8_t *old_ptr = shown;
+
+        // Fill old data
+        uc8151d_spi_send_cmd(0x10);
+        for (size_t h_idx = 0; h_idx < EPD_HEIGHT; h_idx++) {
+            uc8151d_spi_send_data(old_ptr, EPD_ROW_LEN);
+            old_ptr += EPD_ROW_LEN;
+        }
+
+        // Fill new data
+        uc8151d_spi_send_cmd(0x13);
+        for (size_t h_idx = 0; h_idx < EPD_HEIGHT; h_idx++) {
+            uc8151d_spi_send_data(buf_ptr, EPD_ROW_LEN);
+            buf_ptr += EPD_ROW_LEN;
+        }
+
+        uc8151d_keep_window(&full_area);
+    } else {
+        // Both RAMs hold what the panel shows, only the window changed
+        uc8151d_spi_send_cmd(0x91);
+        uc8151d_write_window(0x13, area, frame);
+        uc8151d_spi_send_cmd(0x92);
+        uc8151d_keep_window(area);
     }
 
     // Issue refresh
     uc8151d_spi_send_cmd(0x12);
+}
+
+static void uc8151d_full_finish(void)
+{
     vTaskDelay(pdMS_TO_TICKS(10));
     uc8151d_wait_busy(0);
 
-    uc8151d_sleep();
+    // The window is on the panel now, it's the OLD data of the next refresh
+    uc8151d_spi_send_cmd(0x91);
+    uc8151d_write_window(0x10, &sent_area, shown);
+    uc8151d_spi_send_cmd(0x92);
+    ram_valid = true;
+
+    ESP_LOGD(TAG, "Ready");
 }
 
-void uc8151d_lv_fb_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+static void uc8151d_update_partial(const lv_area_t *area)
 {
-    size_t len = ((area->x2 - area->x1 + 1) * (area->y2 - area->y1 + 1)) / 8;
+    if (!partial_mode || partial_fast != epd_policy_is_fast()) {
+        uc8151d_partial_in();
+    }
+
+    uc8151d_spi_send_cmd(0x91);
+    uc8151d_write_window(0x13, area, frame);
+    uc8151d_keep_window(area);
 
+    // Refresh the window only
+    uc8151d_spi_send_cmd(0x12);
+}
+
+static void uc8151d_partial_finish(void)
+{
+    uc8151d_wait_busy(0);
+
+    // The window is on the panel now, it's the OLD data of the next refresh
+    uc8151d_write_window(0x10, &sent_area, shown);
+    uc8151d_spi_send_cmd(0x92);
+
+    ESP_LOGD(TAG, "Partial updated");
+}
+
+#if defined (CONFIG_LV_EPD_GRAY4)
+// Refresh the window with the gray LUTs, from both bit planes
+static void uc8151d_gray_update(const lv_area_t *area)
+{
+    uc8151d_spi_send_cmd(0x00);
+    uc8151d_spi_send_data_byte(EPD_PSR_REG_LUT);
+
+    uc8151d_spi_send_cmd(0x50);
+    uc8151d_spi_send_data_byte(0x17);
+
+    uc8151d_load_lut(&lut_gray);
+
+    // The partial LUTs have been replaced
+    partial_mode = false;
+
+    uc8151d_spi_send_cmd(0x91);
+    uc8151d_write_window(0x10, area, frame_hi);
+    uc8151d_write_window(0x13, area, frame);
+
+    uc8151d_spi_send_cmd(0x12);
+}
+
+static void uc8151d_gray_finish(void)
+{
+    uc8151d_wait_busy(0);
+    uc8151d_spi_send_cmd(0x92);
+
+    // OLD RAM holds a bit plane instead of what the panel shows
+    ram_valid = false;
+
+    // Back to the OTP LUT, full updates must not run the gray waveform
+    uc8151d_partial_out();
+
+    ESP_LOGD(TAG, "Gray updated");
+}
+#endif
+
+// Stay awake between updates, only wake the panel after it went to sleep
+static void uc8151d_wake(void)
+{
+    if (!awake) {
+        uc8151d_panel_init();
+    } else if (!powered) {
+        uc8151d_power_on();
+    }
+}
+
+// Runs in the epd_refresh task with the frame locked
+static epd_refresh_finish_cb_t uc8151d_upload(const lv_area_t *area)
+{
+    ESP_LOGD(TAG, "Refreshing x1: 0x%x, x2: 0x%x, y1: 0x%x, y2: 0x%x", area->x1, area->x2, area->y1, area->y2);
+
+    uc8151d_wake();
+
+#if defined (CONFIG_LV_EPD_GRAY4)
+    uc8151d_gray_update(area);
+    return uc8151d_gray_finish;
+#else
+    if (!ram_valid) {
+        epd_policy_force_full();
+    }
+
+    if (epd_policy_update(area)) {
+        ESP_LOGD(TAG, "Refreshing in FULL");
+        if (partial_mode) {
+            uc8151d_partial_out();
+        }
+        uc8151d_full_update(area);
+        return uc8151d_full_finish;
+    }
+
+    uc8151d_update_partial(area);
+    return uc8151d_partial_finish;
+#endif
+}
+
+// Benchmark uploads, each runs one waveform regardless of the policy and the gray mode
+static epd_refresh_finish_cb_t uc8151d_bench_full(const lv_area_t *area)
+{
+    uc8151d_wake();
+    if (partial_mode) {
+        uc8151d_partial_out();
+    }
+    uc8151d_full_update(area);
+    return uc8151d_full_finish;
+}
+
+static epd_refresh_finish_cb_t uc8151d_bench_partial(const lv_area_t *area)
+{
+    uc8151d_wake();
+    uc8151d_update_partial(area);
+    return uc8151d_partial_finish;
+}
+
+#if defined (CONFIG_LV_EPD_GRAY4)
+static epd_refresh_finish_cb_t uc8151d_bench_gray(const lv_area_t *area)
+{
+    uc8151d_wake();
+    uc8151d_gray_update(area);
+    return uc8151d_gray_finish;
+}
+#endif
+
+// Runs in the epd_refresh task once no update came for EPD_POWER_OFF_MS
+static void uc8151d_idle(void)
+{
+    epd_refresh_lock();
+    if (powered) {
+        uc8151d_power_off();
+    }
+    epd_refresh_unlock();
+}
+
+void uc8151d_deep_sleep()
+{
+    epd_refresh_wait();
+
+    epd_refresh_lock();
+    if (awake) {
+        uc8151d_sleep();
+    }
+    epd_refresh_unlock();
+}
+
+void uc8151d_benchmark(uint8_t rounds, epd_refresh_stats_t results[EPD_BENCH_COUNT])
+{
+    // Gray last in every round, so the panel ends up with what the gray mode would show
+    const epd_refresh_upload_cb_t uploads[EPD_BENCH_COUNT] = {
+        [EPD_BENCH_FULL] = uc8151d_bench_full,
+        [EPD_BENCH_PARTIAL] = uc8151d_bench_partial,
+#if defined (CONFIG_LV_EPD_GRAY4)
+        [EPD_BENCH_GRAY] = uc8151d_bench_gray,
+#endif
+    };
+
+    epd_refresh_benchmark(uploads, &full_area, rounds, results);
+}
+
+void uc8151d_lv_fb_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
     ESP_LOGD(TAG, "x1: 0x%x, x2: 0x%x, y1: 0x%x, y2: 0x%x", area->x1, area->x2, area->y1, area->y2);
-    ESP_LOGD(TAG, "Writing LVGL fb with len: %u", len);
 
-    uint8_t *buf = (uint8_t *) color_map;
-    uc8151d_full_update(buf);
+    // Keep the area and let epd_refresh merge it with whatever else changes until the panel is idle
+    if (disp_mono_native(drv)) {
+        lv_area_t fb_area;
 
-    lv_disp_flush_ready(drv);
-    ESP_LOGD(TAG, "Ready");
+        epd_refresh_lock();
+#if defined (CONFIG_LV_EPD_GRAY4)
+        disp_mono_pack_planes(area, color_map, EPD_ROT, frame_hi, frame, EPD_ROW_LEN, 1, &fb_area);
+#else
+        disp_mono_pack_rows(area, color_map, EPD_ROT, frame, EPD_ROW_LEN, 1, &fb_area);
+#endif
+        epd_refresh_unlock();
+
+        epd_refresh_mark(drv, &fb_area);
+    } else {
+        epd_refresh_lock();
+        epd_refresh_copy_rows(frame, EPD_ROW_LEN, area, (uint8_t *) color_map);
+#if defined (CONFIG_LV_EPD_GRAY4)
+        // Black and white only, both planes hold the same
+        epd_refresh_copy_rows(frame_hi, EPD_ROW_LEN, area, (uint8_t *) color_map);
+#endif
+        epd_refresh_unlock();
+
+        epd_refresh_mark(drv, area);
+    }
 }
 
 void uc8151d_lv_set_fb_cb(struct _disp_drv_t *disp_drv, uint8_t *buf, lv_coord_t buf_w, lv_coord_t x, lv_coord_t y,
                            lv_color_t color, lv_opa_t opa)
 {
-    uint16_t byte_index = (x >> 3u) + (y * EPD_ROW_LEN);
+    // buf holds the rounded area only, buf_w is a multiple of 8
+    uint16_t byte_index = (x >> 3u) + (y * (buf_w >> 3u));
     uint8_t bit_index = x & 0x07u;
 
     if (color.full) {
@@ -224,11 +670,13 @@ void uc8151d_lv_set_fb_cb(struct _disp_drv_t *disp_drv, uint8_t *buf, lv_coord_t
 
 void uc8151d_lv_rounder_cb(struct _disp_drv_t *disp_drv, lv_area_t *area)
 {
-    // Always send full framebuffer if it's not in partial mode
-    area->x1 = 0;
-    area->y1 = 0;
-    area->x2 = EPD_WIDTH - 1;
-    area->y2 = EPD_HEIGHT - 1;
+    // The frame copy holds the rest of the screen, LVGL only has to render whole bytes (after rotation)
+    if (disp_mono_native(disp_drv)) {
+        disp_mono_round_rows(area, EPD_ROT);
+    } else {
+        area->x1 &= ~0x07;
+        area->x2 |= 0x07;
+    }
 }
 
 void uc8151d_init()
@@ -265,4 +713,7 @@ void uc8151d_init()
     ESP_LOGI(TAG, "IO init finished");
     uc8151d_panel_init();
     ESP_LOGI(TAG, "Panel initialised");
+
+    epd_refresh_init(uc8151d_upload);
+    epd_refresh_set_idle(uc8151d_idle, EPD_POWER_OFF_MS);
 }
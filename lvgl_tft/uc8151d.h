@@ -28,12 +28,18 @@
 #define LVGL_DEMO_UC8151D_H
 
 #include <lvgl.h>
+#include "epd_refresh.h"
 
 void uc8151d_init();
+void uc8151d_deep_sleep();
 void uc8151d_lv_set_fb_cb(struct _disp_drv_t *disp_drv, uint8_t *buf, lv_coord_t buf_w, lv_coord_t x, lv_coord_t y,
                           lv_color_t color, lv_opa_t opa);
 
 void uc8151d_lv_rounder_cb(struct _disp_drv_t *disp_drv, lv_area_t *area);
 void uc8151d_lv_fb_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map);
 
+// Time "rounds" whole-screen refreshes with each waveform (full, partial and with CONFIG_LV_EPD_GRAY4 gray),
+// results are indexed by EPD_BENCH_FULL etc. and logged. The panel shows the frame again afterwards.
+void uc8151d_benchmark(uint8_t rounds, epd_refresh_stats_t results[EPD_BENCH_COUNT]);
+
 #endif //LVGL_DEMO_UC8151D_H
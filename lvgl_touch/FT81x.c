@@ -22,6 +22,21 @@
 /*********************
  *      DEFINES
  *********************/
+#define NO_TOUCH            0x8000
+
+#if defined (CONFIG_LV_FT81X_MULTI_TOUCH)
+#define TOUCH_POINTS        CONFIG_LV_FT81X_TOUCH_POINTS
+#else
+#define TOUCH_POINTS        1
+#endif
+
+/* the touch registers of the capacitive engine are spread over this block, it is read in one go */
+#define TOUCH_BLOCK_START   REG_CTOUCH_TOUCH1_XY
+#define TOUCH_BLOCK_LEN     (REG_CTOUCH_TOUCH3_XY + 4 - TOUCH_BLOCK_START)
+
+#if defined (CONFIG_LV_FT81X_MULTI_TOUCH) && (LVGL_VERSION_MAJOR < 8)
+#error "CONFIG_LV_FT81X_MULTI_TOUCH needs LvGL 8 to tell the input devices apart"
+#endif
 
 /**********************
  *      TYPEDEFS
@@ -30,10 +45,15 @@
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static void touch_update(void);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
+static lv_point_t points[TOUCH_POINTS];
+static bool pressed[TOUCH_POINTS];
+static uint8_t touch_cnt = 0;
+static uint8_t served = 0xff;    /* input devices that already got the result of the last update */
 
 /**********************
  *      MACROS
@@ -44,42 +64,131 @@
  **********************/
 
 
+/**
+ * Set up the touch engine, called after the display is initialized
+ */
+void FT81x_touch_init(void)
+{
+#if defined (CONFIG_LV_FT81X_MULTI_TOUCH)
+    EVE_memWrite8(REG_CTOUCH_EXTENDED, 0);    /* extended mode, up to five touches */
+#endif
+    EVE_memRead8(REG_INT_FLAGS);    /* reading clears the flags */
+    served = 0xff;
+}
+
+
 /**
  * Get the current position and state of the touchpad
+ * With CONFIG_LV_FT81X_MULTI_TOUCH every touch is an input device of its own, drv->user_data is the touch number 0 to 4
  * @param data store the read data here
  * @return false: because no more data to be read
  */
 bool FT81x_read(lv_indev_drv_t * drv, lv_indev_data_t * data)
 {
-    static int16_t last_x = 0;
-    static int16_t last_y = 0;
-   	bool touched = true;
-
-	uint32_t XY = EVE_memRead32(REG_TOUCH_SCREEN_XY);
-	uint16_t Y = XY & 0xffff;
-	uint16_t X = XY >> 16;
-
-	// is it not touched (or invalid because of calibration range)
-	if(X == 0x8000 || Y == 0x8000 || X > LV_HOR_RES_MAX || Y > LV_VER_RES_MAX)
-	{
-		touched = false;
-		X = last_x;
-		Y = last_y;
-	}
-	else
-	{
-		last_x = X;
-		last_y = Y;
-	}
-
-    data->point.x = X;
-    data->point.y = Y;
-    data->state = (touched == false ? LV_INDEV_STATE_REL : LV_INDEV_STATE_PR);
+    uint8_t index = 0;
+
+#if defined (CONFIG_LV_FT81X_MULTI_TOUCH)
+    index = (uint8_t)(uintptr_t) drv->user_data;
+    if(index >= TOUCH_POINTS)
+    {
+        index = 0;
+    }
+#endif
+
+    /* the first input device to ask again after all of them got the last result triggers the next update */
+    if(served & (1 << index))
+    {
+        touch_update();
+        served = 0;
+    }
+    served |= (1 << index);
+
+    data->point = points[index];
+    data->state = (pressed[index] ? LV_INDEV_STATE_PR : LV_INDEV_STATE_REL);
 
     return false;
 }
 
 
+/**
+ * Get all current touches, e.g. for gestures
+ * @param touches store up to "max" points here
+ * @return the number of touches
+ */
+uint8_t FT81x_touch_points(lv_point_t * touches, uint8_t max)
+{
+    uint8_t cnt = 0;
+
+    for(uint8_t i = 0; i < TOUCH_POINTS && cnt < max; i++)
+    {
+        if(pressed[i])
+        {
+            touches[cnt++] = points[i];
+        }
+    }
+
+    return cnt;
+}
+
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
+
+static inline uint32_t block_get(const uint8_t * block, uint32_t reg)
+{
+    const uint8_t * p = &block[reg - TOUCH_BLOCK_START];
+
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+
+static void touch_set(uint8_t index, uint16_t X, uint16_t Y)
+{
+    /* is it not touched (or invalid because of calibration range), the last point is kept for the release */
+    if(X == NO_TOUCH || Y == NO_TOUCH || X > LV_HOR_RES_MAX || Y > LV_VER_RES_MAX)
+    {
+        pressed[index] = false;
+        return;
+    }
+
+    points[index].x = X;
+    points[index].y = Y;
+    pressed[index] = true;
+    touch_cnt++;
+}
+
+
+/**
+ * Read all touches, skipped while nothing is touched and the touch interrupt flag is not set
+ */
+static void touch_update(void)
+{
+    uint8_t flags = EVE_memRead8(REG_INT_FLAGS);
+
+    if(touch_cnt == 0 && !(flags & EVE_INT_TOUCH))
+    {
+        return;
+    }
+
+#if TOUCH_POINTS > 1
+    uint8_t block[TOUCH_BLOCK_LEN];
+    EVE_memRead_buffer(TOUCH_BLOCK_START, block, sizeof(block));
+
+    uint32_t xy[5] = {
+        block_get(block, REG_CTOUCH_TOUCH0_XY),
+        block_get(block, REG_CTOUCH_TOUCH1_XY),
+        block_get(block, REG_CTOUCH_TOUCH2_XY),
+        block_get(block, REG_CTOUCH_TOUCH3_XY),
+        (block_get(block, REG_CTOUCH_TOUCH4_X) << 16) | (block_get(block, REG_CTOUCH_TOUCH4_Y) & 0xffff)
+    };
+#else
+    uint32_t xy[1] = { EVE_memRead32(REG_TOUCH_SCREEN_XY) };
+#endif
+
+    touch_cnt = 0;
+    for(uint8_t i = 0; i < TOUCH_POINTS; i++)
+    {
+        touch_set(i, xy[i] >> 16, xy[i] & 0xffff);
+    }
+}
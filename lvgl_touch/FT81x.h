@@ -33,7 +33,9 @@ extern "C" {
  * GLOBAL PROTOTYPES
  **********************/
 ;
+void FT81x_touch_init(void);
 bool FT81x_read(lv_indev_drv_t * drv, lv_indev_data_t * data);
+uint8_t FT81x_touch_points(lv_point_t * touches, uint8_t max);
 
 /**********************
  *      MACROS
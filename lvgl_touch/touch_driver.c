@@ -17,7 +17,7 @@ void touch_driver_init(void)
 #elif defined (CONFIG_LV_TOUCH_CONTROLLER_ADCRAW)
     adcraw_init();
 #elif defined (CONFIG_LV_TOUCH_CONTROLLER_FT81X)
-    /* nothing to do */
+    FT81x_touch_init();
 #elif defined (CONFIG_LV_TOUCH_CONTROLLER_RA8875)
     ra8875_touch_init();
 #elif defined (CONFIG_LV_TOUCH_CONTROLLER_GT911)
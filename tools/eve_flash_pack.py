@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""
+Pack assets into a flash image for the external flash of BT81x boards.
+
+Layout of the image:
+    0x0000  flash blob from EVE Asset Builder (unified.blob), needed for CMD_FLASHFAST
+    0x1000  index: 16 byte header followed by one 32 byte entry per asset
+    ...     asset data, every asset starts 64 byte aligned
+
+Header:  "EVEA", uint16 version, uint16 count, 8 bytes reserved
+Entry:   char name[16], uint32 addr, uint32 size, uint16 format, uint16 width, uint16 height, uint16 reserved
+         (little endian, "format" is the EVE bitmap format or 0 for raw data)
+
+The index is read by FT81x_flash_init() in lvgl_tft/FT81x_flash.c. ASTC bitmaps are rendered straight
+from flash, raw data (e.g. legacy fonts) can be copied to RAM_G with CMD_FLASHREAD.
+
+Examples:
+    eve_flash_pack.py -b unified.blob -o flash.bin --astc logo=logo.astc --raw font=roboto_l4.raw
+    eve_flash_pack.py -b unified.blob -o flash.bin --bitmap bg=bg.raw:ASTC_8x8:800x480 -H assets.h
+
+Write the image with e.g. EVE Asset Builder or a programmer, or at runtime with EVE_cmd_flashupdate().
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+BLOB_SIZE = 4096
+INDEX_ADDR = 0x1000
+HEADER_FMT = "<4sHH8x"
+ENTRY_FMT = "<16sIIHHHH"
+ALIGN = 64
+VERSION = 1
+
+ASTC_MAGIC = 0x5CA1AB13
+ASTC_BLOCKS = ["4x4", "5x4", "5x5", "6x5", "6x6", "8x5", "8x6", "8x8",
+               "10x5", "10x6", "10x8", "10x10", "12x10", "12x12"]
+ASTC_FORMAT_BASE = 37808  # EVE_COMPRESSED_RGBA_ASTC_4x4_KHR
+
+
+def astc_format(block):
+    if block not in ASTC_BLOCKS:
+        raise ValueError("unsupported ASTC block size %s" % block)
+    return ASTC_FORMAT_BASE + ASTC_BLOCKS.index(block)
+
+
+def read_astc(path):
+    """.astc file: 16 byte header with block size and image size, followed by the blocks"""
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, bx, by, bz = struct.unpack_from("<IBBB", data, 0)
+    if magic != ASTC_MAGIC:
+        raise ValueError("%s is not an .astc file" % path)
+    if bz != 1:
+        raise ValueError("%s: 3D ASTC is not supported" % path)
+    width = int.from_bytes(data[7:10], "little")
+    height = int.from_bytes(data[10:13], "little")
+    return data[16:], astc_format("%dx%d" % (bx, by)), width, height
+
+
+def parse_asset(spec, kind):
+    name, _, rest = spec.partition("=")
+    if not name or not rest:
+        raise ValueError("expected name=file, got %s" % spec)
+    if len(name.encode()) > 15:
+        raise ValueError("asset name %s is longer than 15 characters" % name)
+
+    if kind == "astc":
+        data, fmt, width, height = read_astc(rest)
+    elif kind == "bitmap":
+        # file:ASTC_<block>:<w>x<h>, e.g. the .raw output of EVE Asset Builder
+        m = re.fullmatch(r"(.+):ASTC_(\d+x\d+):(\d+)x(\d+)", rest)
+        if not m:
+            raise ValueError("expected name=file:ASTC_<block>:<w>x<h>, got %s" % spec)
+        with open(m.group(1), "rb") as f:
+            data = f.read()
+        fmt, width, height = astc_format(m.group(2)), int(m.group(3)), int(m.group(4))
+    else:
+        with open(rest, "rb") as f:
+            data = f.read()
+        fmt, width, height = 0, 0, 0
+
+    return name, data, fmt, width, height
+
+
+def align(value):
+    return (value + ALIGN - 1) & ~(ALIGN - 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-b", "--blob", required=True, help="flash blob from EVE Asset Builder (4096 bytes)")
+    parser.add_argument("-o", "--output", required=True, help="flash image to write")
+    parser.add_argument("-H", "--header", help="also write a C header with the asset names and addresses")
+    parser.add_argument("--astc", action="append", default=[], metavar="NAME=FILE.astc", help="ASTC bitmap")
+    parser.add_argument("--bitmap", action="append", default=[], metavar="NAME=FILE:ASTC_4x4:WxH", help="ASTC bitmap without header")
+    parser.add_argument("--raw", action="append", default=[], metavar="NAME=FILE", help="raw data, e.g. a legacy font")
+    parser.add_argument("--size", type=lambda x: int(x, 0), help="flash size in bytes, to check that everything fits")
+    args = parser.parse_args()
+
+    with open(args.blob, "rb") as f:
+        blob = f.read()
+    if len(blob) != BLOB_SIZE:
+        sys.exit("the flash blob has to be %d bytes" % BLOB_SIZE)
+
+    try:
+        assets = [parse_asset(s, "astc") for s in args.astc]
+        assets += [parse_asset(s, "bitmap") for s in args.bitmap]
+        assets += [parse_asset(s, "raw") for s in args.raw]
+    except (OSError, ValueError) as e:
+        sys.exit(str(e))
+
+    names = [a[0] for a in assets]
+    if len(set(names)) != len(names):
+        sys.exit("asset names have to be unique")
+
+    index_size = struct.calcsize(HEADER_FMT) + len(assets) * struct.calcsize(ENTRY_FMT)
+    addr = align(INDEX_ADDR + index_size)
+
+    index = struct.pack(HEADER_FMT, b"EVEA", VERSION, len(assets))
+    body = b""
+    placed = []
+    for name, data, fmt, width, height in assets:
+        index += struct.pack(ENTRY_FMT, name.encode(), addr, len(data), fmt, width, height, 0)
+        body += data + bytes(align(len(data)) - len(data))
+        placed.append((name, addr, len(data), fmt, width, height))
+        addr += align(len(data))
+
+    image = blob + index + bytes(align(INDEX_ADDR + index_size) - INDEX_ADDR - len(index)) + body
+
+    if args.size and len(image) > args.size:
+        sys.exit("the image needs %d bytes, the flash has %d" % (len(image), args.size))
+
+    with open(args.output, "wb") as f:
+        f.write(image)
+
+    if args.header:
+        guard = re.sub(r"\W", "_", os.path.basename(args.header)).upper()
+        with open(args.header, "w") as f:
+            f.write("/* generated by eve_flash_pack.py */\n")
+            f.write("#ifndef %s\n#define %s\n\n" % (guard, guard))
+            for name, a, size, fmt, width, height in placed:
+                macro = "EVE_ASSET_" + re.sub(r"\W", "_", name).upper()
+                f.write('#define %s_NAME\t"%s"\n' % (macro, name))
+                f.write("#define %s_ADDR\t0x%06xUL\n" % (macro, a))
+                f.write("#define %s_SIZE\t%dUL\n" % (macro, size))
+                if fmt:
+                    f.write("#define %s_W\t%d\n#define %s_H\t%d\n" % (macro, width, macro, height))
+                f.write("\n")
+            f.write("#endif\n")
+
+    for name, a, size, fmt, width, height in placed:
+        kind = "%dx%d ASTC %s" % (width, height, ASTC_BLOCKS[fmt - ASTC_FORMAT_BASE]) if fmt else "raw"
+        print("0x%06x %8d  %-15s %s" % (a, size, name, kind))
+    print("%d bytes" % len(image))
+
+
+if __name__ == "__main__":
+    main()